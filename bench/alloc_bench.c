@@ -0,0 +1,205 @@
+/**
+ * File: alloc_bench.c
+ *
+ * Project: CLManager
+ *
+ * Author: Issiah J Banda
+ *
+ * Date Of Creation: 2026-10-17 //YYYY-MM-DD
+ *
+ * Description: Counts the allocations made while loading every book with getBooks
+ *              and with getBooksArena, and while freeing them again. Linked by
+ *              "make bench" with malloc, calloc, realloc and free wrapped, so only
+ *              the allocations made by the project's own code are counted, not
+ *              the ones sqlite makes internally.
+ *
+ * Modification History:
+ *      - 2026-10-17: Created the allocation count benchmark.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "dbmanager.h"
+
+/* The number of books loaded unless given on the command line.*/
+#define DEFAULT_BENCH_ROWS 100000
+
+/* The directory the benchmark runs in, so makeConnection creates a scratch
+    library in it instead of using the real one. Removed when it is done.*/
+#define BENCH_DIR "build/alloc_bench"
+
+/* Allocation counts taken by the wrapped allocation functions.*/
+typedef struct {
+    /* Calls to malloc, calloc and realloc with a NULL pointer*/
+    long allocs;
+    /* Calls to realloc that moved or grew an existing block*/
+    long reallocs;
+    /* Calls to free with a non NULL pointer*/
+    long frees;
+} AllocCounts;
+
+static AllocCounts counts;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+void* __wrap_malloc(size_t size) {
+    counts.allocs++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    counts.allocs++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    if (ptr == NULL) {
+        counts.allocs++;
+    } else {
+        counts.reallocs++;
+    }
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr) {
+    if (ptr != NULL) {
+        counts.frees++;
+    }
+    __real_free(ptr);
+}
+
+/**
+ * Fills the library with numBooks generated books, each with its own title
+ * and ISBN and one of a few authors, publishers, genres and languages.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int fillLibrary(long numBooks);
+/**
+ * Loads every book with a getBooks function, then frees them, printing the
+ * allocations and the time each step took.
+ * @param name The name printed for the mode.
+ * @param load getBooks or getBooksArena.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int benchMode(const char* name, BookArray (*load)(void));
+static double secondsSince(const struct timespec* start);
+
+int main(int argc, char* argv[]) {
+    long numBooks = argc > 1 ? atol(argv[1]) : DEFAULT_BENCH_ROWS;
+    if (numBooks <= 0) {
+        fprintf(stderr, "Usage: %s [rows]\n", argv[0]);
+        return 1;
+    }
+
+    // Never fall through to the real library in data/
+    mkdir(BENCH_DIR, 0755);
+    if (chdir(BENCH_DIR) != 0) {
+        fprintf(stderr, "Cannot enter %s\n", BENCH_DIR);
+        return 1;
+    }
+    // A run that was stopped leaves its library behind
+    mkdir("data", 0755);
+    remove("data/library.db");
+    if (makeConnection() == OPERATION_FAIL) {
+        fprintf(stderr, "Cannot create the scratch library in %s\n", BENCH_DIR);
+        return 1;
+    }
+
+    int ok = fillLibrary(numBooks);
+    if (ok) {
+        printf("%ld rows\n", numBooks);
+        printf("%-8s %10s %10s %10s %10s %10s\n", "mode", "load", "reallocs", "free", "load ms", "free ms");
+        // Load once first, so the statement cache and page cache are warm for both modes
+        BookArray warm = getBooks();
+        freeBookArray(&warm);
+        ok = benchMode("malloc", getBooks) && benchMode("arena", getBooksArena);
+    }
+
+    closeConnection();
+    remove("data/library.db");
+    remove("data/library.db-journal");
+    remove("data/library.db-wal");
+    remove("data/library.db-shm");
+    rmdir("data");
+    if (chdir("../..") == 0) {
+        rmdir(BENCH_DIR);
+    }
+    return ok ? 0 : 1;
+}
+
+static int fillLibrary(long numBooks) {
+    static const char* const authors[] = {"Ursula K. Le Guin", "J.R.R. Tolkien", "Octavia E. Butler", "Iain M. Banks"};
+    static const char* const publishers[] = {"Ace", "Allen & Unwin", "Orbit", NULL};
+    static const char* const genres[] = {"Fantasy", "Science Fiction", "Horror"};
+    static const char* const languages[] = {"English", "French"};
+
+    BookData* books = malloc(numBooks * sizeof(BookData));
+    char (*titles)[32] = malloc(numBooks * sizeof(*titles));
+    char (*isbns)[14] = malloc(numBooks * sizeof(*isbns));
+    if (books == NULL || titles == NULL || isbns == NULL) {
+        fprintf(stderr, "Error Allocating Memory in fillLibrary\n");
+        free(books);
+        free(titles);
+        free(isbns);
+        return 0;
+    }
+
+    for (long i = 0; i < numBooks; i++) {
+        snprintf(titles[i], sizeof(titles[i]), "Book Number %ld", i);
+        snprintf(isbns[i], sizeof(isbns[i]), "978%010ld", i);
+        books[i] = (BookData) {
+            .title = titles[i],
+            .author = (char*) authors[i % 4],
+            .publisher = (char*) publishers[i % 4],
+            .publicationDate = "2026-10-17",
+            .ISBN = isbns[i],
+            .genre = (char*) genres[i % 3],
+            .lang = (char*) languages[i % 2],
+            .numPages = (int) (100 + i % 900)
+        };
+    }
+
+    long inserted = addBooks(books, (size_t) numBooks, NULL);
+    free(books);
+    free(titles);
+    free(isbns);
+    if (inserted != numBooks) {
+        fprintf(stderr, "Only %ld of %ld books were inserted\n", inserted, numBooks);
+        return 0;
+    }
+    return 1;
+}
+
+static int benchMode(const char* name, BookArray (*load)(void)) {
+    struct timespec start;
+    AllocCounts before = counts;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    BookArray array = load();
+    double loadSeconds = secondsSince(&start);
+    AllocCounts loaded = counts;
+    if (array.books == NULL) {
+        fprintf(stderr, "Error loading books in %s mode\n", name);
+        return 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    freeBookArray(&array);
+    double freeSeconds = secondsSince(&start);
+
+    printf("%-8s %10ld %10ld %10ld %10.1f %10.1f\n", name, loaded.allocs - before.allocs,
+           loaded.reallocs - before.reallocs, counts.frees - loaded.frees, loadSeconds * 1e3, freeSeconds * 1e3);
+    return 1;
+}
+
+static double secondsSince(const struct timespec* start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
@@ -0,0 +1,236 @@
+/**
+ * File: column_bench.c
+ *
+ * Project: CLManager
+ *
+ * Author: Issiah J Banda
+ *
+ * Date Of Creation: 2026-10-17 //YYYY-MM-DD
+ *
+ * Description: Times a scan over the title of every book, once through a BookArray
+ *              loaded with getBooks and with getBooksArena, and once through the
+ *              BookColumns of getBookColumns. Each scan is repeated and the fastest
+ *              run is kept, so the numbers show the memory layout and not the cost
+ *              of loading the books.
+ *
+ * Modification History:
+ *      - 2026-10-17: Created the title scan benchmark.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dbmanager.h"
+
+/* The number of books scanned unless given on the command line.*/
+#define DEFAULT_BENCH_ROWS 1000000
+/* The number of times each scan runs, the fastest run is printed.*/
+#define SCAN_REPEATS 10
+
+/* The scratch library the books are stored in, removed when the benchmark is done.*/
+#define BENCH_DIR "build/column_bench"
+#define BENCH_DB BENCH_DIR "/library.db"
+
+/* The result of one scan, printed so the scan cannot be optimized away.*/
+typedef struct {
+    /* Bytes in every title*/
+    long long bytes;
+    /* Titles that end in the digit 7*/
+    long matches;
+} ScanResult;
+
+/**
+ * Fills the library with numBooks generated books, each with its own title
+ * and ISBN and one of a few authors, publishers, genres and languages.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int fillLibrary(LibraryDb* library, long numBooks);
+/**
+ * Scans the title of every book in a BookArray SCAN_REPEATS times and prints
+ * the fastest run.
+ * @param name The name printed for the layout.
+ * @param array The books scanned.
+ * @param loadSeconds The time loading the books took, printed next to it.
+*/
+static void scanArray(const char* name, const BookArray* array, double loadSeconds);
+/**
+ * Scans every title in a BookColumns SCAN_REPEATS times and prints the fastest run.
+ * @param columns The books scanned.
+ * @param loadSeconds The time loading the books took, printed next to it.
+*/
+static void scanColumns(const BookColumns* columns, double loadSeconds);
+static void addTitle(ScanResult* result, const char* title, size_t length);
+static void removeLibrary(void);
+static double secondsSince(const struct timespec* start);
+
+int main(int argc, char* argv[]) {
+    long numBooks = argc > 1 ? atol(argv[1]) : DEFAULT_BENCH_ROWS;
+    if (numBooks <= 0) {
+        fprintf(stderr, "Usage: %s [rows]\n", argv[0]);
+        return 1;
+    }
+
+    mkdir(BENCH_DIR, 0755);
+    // A run that was stopped leaves its library behind
+    removeLibrary();
+    ConnectionProfile profile = connectionProfilePreset(PROFILE_BULK_LOAD);
+    LibraryDb* library = libraryOpenEx(BENCH_DB, LIBRARY_READWRITE, &profile);
+    if (library == NULL) {
+        fprintf(stderr, "Cannot create the scratch library %s\n", BENCH_DB);
+        return 1;
+    }
+
+    int ok = fillLibrary(library, numBooks);
+    if (ok) {
+        printf("%ld rows, fastest of %d scans\n", numBooks, SCAN_REPEATS);
+        printf("%-8s %10s %10s %12s %10s\n", "layout", "load ms", "scan ms", "title bytes", "matches");
+        // Load once first, so the page cache is warm for every layout
+        BookArray array = libraryGetBooks(library);
+        freeBookArray(&array);
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        array = libraryGetBooks(library);
+        double loadSeconds = secondsSince(&start);
+        ok = array.books != NULL;
+        if (ok) {
+            scanArray("malloc", &array, loadSeconds);
+        }
+        freeBookArray(&array);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        array = libraryGetBooksArena(library);
+        loadSeconds = secondsSince(&start);
+        ok = ok && array.books != NULL;
+        if (ok) {
+            scanArray("arena", &array, loadSeconds);
+        }
+        freeBookArray(&array);
+
+        BookColumns columns = {0};
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        ok = ok && libraryGetBookColumns(library, NULL, &columns) == OPERATION_SUCCESS;
+        loadSeconds = secondsSince(&start);
+        if (ok) {
+            scanColumns(&columns, loadSeconds);
+        }
+        freeBookColumns(&columns);
+    }
+
+    libraryClose(library);
+    removeLibrary();
+    rmdir(BENCH_DIR);
+    return ok ? 0 : 1;
+}
+
+static int fillLibrary(LibraryDb* library, long numBooks) {
+    static const char* const authors[] = {"Ursula K. Le Guin", "J.R.R. Tolkien", "Octavia E. Butler", "Iain M. Banks"};
+    static const char* const publishers[] = {"Ace", "Allen & Unwin", "Orbit", NULL};
+    static const char* const genres[] = {"Fantasy", "Science Fiction", "Horror"};
+    static const char* const languages[] = {"English", "French"};
+
+    BookData* books = malloc(numBooks * sizeof(BookData));
+    char (*titles)[32] = malloc(numBooks * sizeof(*titles));
+    char (*isbns)[14] = malloc(numBooks * sizeof(*isbns));
+    if (books == NULL || titles == NULL || isbns == NULL) {
+        fprintf(stderr, "Error Allocating Memory in fillLibrary\n");
+        free(books);
+        free(titles);
+        free(isbns);
+        return 0;
+    }
+
+    for (long i = 0; i < numBooks; i++) {
+        snprintf(titles[i], sizeof(titles[i]), "Book Number %ld", i);
+        snprintf(isbns[i], sizeof(isbns[i]), "978%010ld", i);
+        books[i] = (BookData) {
+            .title = titles[i],
+            .author = (char*) authors[i % 4],
+            .publisher = (char*) publishers[i % 4],
+            .publicationDate = "2026-10-17",
+            .ISBN = isbns[i],
+            .genre = (char*) genres[i % 3],
+            .lang = (char*) languages[i % 2],
+            .numPages = (int) (100 + i % 900)
+        };
+    }
+
+    long inserted = libraryAddBooks(library, books, (size_t) numBooks, NULL);
+    free(books);
+    free(titles);
+    free(isbns);
+    if (inserted != numBooks) {
+        fprintf(stderr, "Only %ld of %ld books were inserted\n", inserted, numBooks);
+        return 0;
+    }
+    return 1;
+}
+
+static void scanArray(const char* name, const BookArray* array, double loadSeconds) {
+    double best = 0;
+    ScanResult result;
+    for (int run = 0; run < SCAN_REPEATS; run++) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        result = (ScanResult) {0, 0};
+        for (int i = 0; i < array->count; i++) {
+            const char* title = array->books[i]->title;
+            if (title != NULL) {
+                addTitle(&result, title, strlen(title));
+            }
+        }
+        double seconds = secondsSince(&start);
+        if (run == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    printf("%-8s %10.1f %10.2f %12lld %10ld\n", name, loadSeconds * 1e3, best * 1e3, result.bytes, result.matches);
+}
+
+static void scanColumns(const BookColumns* columns, double loadSeconds) {
+    double best = 0;
+    ScanResult result;
+    const BookColumn* title = &columns->title;
+    for (int run = 0; run < SCAN_REPEATS; run++) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        result = (ScanResult) {0, 0};
+        for (int i = 0; i < columns->count; i++) {
+            // A title's room includes its terminator, so the offsets give its
+            // length without strlen. A NULL title takes no room
+            uint32_t size = title->offsets[i + 1] - title->offsets[i];
+            if (size > 0) {
+                addTitle(&result, title->data + title->offsets[i], size - 1);
+            }
+        }
+        double seconds = secondsSince(&start);
+        if (run == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    printf("%-8s %10.1f %10.2f %12lld %10ld\n", "columns", loadSeconds * 1e3, best * 1e3, result.bytes, result.matches);
+}
+
+static void addTitle(ScanResult* result, const char* title, size_t length) {
+    result->bytes += length;
+    if (length > 0 && title[length - 1] == '7') {
+        result->matches++;
+    }
+}
+
+static void removeLibrary(void) {
+    remove(BENCH_DB);
+    remove(BENCH_DB "-journal");
+    remove(BENCH_DB "-wal");
+    remove(BENCH_DB "-shm");
+}
+
+static double secondsSince(const struct timespec* start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
@@ -0,0 +1,179 @@
+/**
+ * File: profile_bench.c
+ *
+ * Project: CLManager
+ *
+ * Author: Issiah J Banda
+ *
+ * Date Of Creation: 2026-10-17 //YYYY-MM-DD
+ *
+ * Description: Measures the insert and read throughput of each preset connection
+ *              profile on a scratch library. Batched inserts go through addBooks,
+ *              single inserts commit one book at a time, and reads load every
+ *              book with getBooks.
+ *
+ * Modification History:
+ *      - 2026-10-17: Created the connection profile benchmark.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dbmanager.h"
+
+/* The number of books inserted in a batch unless given on the command line.*/
+#define DEFAULT_BENCH_ROWS 100000
+/* One single insert, each its own commit, is made for this many batched rows.*/
+#define SINGLE_INSERT_RATIO 100
+
+/* The scratch library each preset is measured on, removed before every preset
+    and when the benchmark is done.*/
+#define BENCH_DIR "build/profile_bench"
+#define BENCH_DB BENCH_DIR "/library.db"
+
+/**
+ * Measures one preset on a new scratch library and prints its throughput.
+ * @param name The name printed for the preset.
+ * @param preset The preset measured.
+ * @param books The books inserted in one batch.
+ * @param numBooks The number of books.
+ * @param singles The books inserted one commit at a time.
+ * @param numSingles The number of single books.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int benchPreset(const char* name, ProfilePreset preset, const BookData* books, long numBooks,
+                       const BookData* singles, long numSingles);
+/**
+ * Generates books, each with its own title and an ISBN made of the prefix and
+ * its index, and one of a few authors, publishers, genres and languages.
+ * @param books Receives the books, which point into titles and isbns.
+ * @param titles Receives the titles, numBooks entries of 32 bytes.
+ * @param isbns Receives the ISBNs, numBooks entries of 14 bytes.
+ * @param isbnPrefix The first 3 digits of every ISBN.
+*/
+static void makeBooks(BookData* books, char (*titles)[32], char (*isbns)[14], long numBooks, const char* isbnPrefix);
+static void removeLibrary(void);
+static double secondsSince(const struct timespec* start);
+
+int main(int argc, char* argv[]) {
+    long numBooks = argc > 1 ? atol(argv[1]) : DEFAULT_BENCH_ROWS;
+    if (numBooks <= 0) {
+        fprintf(stderr, "Usage: %s [rows]\n", argv[0]);
+        return 1;
+    }
+    long numSingles = numBooks / SINGLE_INSERT_RATIO > 0 ? numBooks / SINGLE_INSERT_RATIO : 1;
+
+    BookData* books = malloc((numBooks + numSingles) * sizeof(BookData));
+    char (*titles)[32] = malloc((numBooks + numSingles) * sizeof(*titles));
+    char (*isbns)[14] = malloc((numBooks + numSingles) * sizeof(*isbns));
+    if (books == NULL || titles == NULL || isbns == NULL) {
+        fprintf(stderr, "Error Allocating Memory in profile_bench\n");
+        free(books);
+        free(titles);
+        free(isbns);
+        return 1;
+    }
+    makeBooks(books, titles, isbns, numBooks, "978");
+    makeBooks(books + numBooks, titles + numBooks, isbns + numBooks, numSingles, "979");
+
+    mkdir(BENCH_DIR, 0755);
+    printf("%ld batched rows, %ld single rows\n", numBooks, numSingles);
+    printf("%-10s %14s %14s %14s\n", "preset", "batch rows/s", "single rows/s", "read rows/s");
+    int ok = benchPreset("durable", PROFILE_DURABLE, books, numBooks, books + numBooks, numSingles) &&
+             benchPreset("balanced", PROFILE_BALANCED, books, numBooks, books + numBooks, numSingles) &&
+             benchPreset("bulk_load", PROFILE_BULK_LOAD, books, numBooks, books + numBooks, numSingles);
+
+    removeLibrary();
+    rmdir(BENCH_DIR);
+    free(books);
+    free(titles);
+    free(isbns);
+    return ok ? 0 : 1;
+}
+
+static int benchPreset(const char* name, ProfilePreset preset, const BookData* books, long numBooks,
+                       const BookData* singles, long numSingles) {
+    removeLibrary();
+    ConnectionProfile profile = connectionProfilePreset(preset);
+    LibraryDb* library = libraryOpenEx(BENCH_DB, LIBRARY_READWRITE, &profile);
+    if (library == NULL) {
+        fprintf(stderr, "Cannot create the scratch library %s\n", BENCH_DB);
+        return 0;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    long inserted = libraryAddBooks(library, books, (size_t) numBooks, NULL);
+    double batchSeconds = secondsSince(&start);
+    if (inserted != numBooks) {
+        fprintf(stderr, "Only %ld of %ld books were inserted\n", inserted, numBooks);
+        libraryClose(library);
+        return 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < numSingles; i++) {
+        if (libraryAddBook(library, singles[i]) == OPERATION_FAIL) {
+            fprintf(stderr, "Error inserting single book %ld\n", i);
+            libraryClose(library);
+            return 0;
+        }
+    }
+    double singleSeconds = secondsSince(&start);
+
+    // Load once first, so every preset is read from a warm page cache
+    BookArray array = libraryGetBooks(library);
+    freeBookArray(&array);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    array = libraryGetBooks(library);
+    double readSeconds = secondsSince(&start);
+    int rows = array.count;
+    freeBookArray(&array);
+    libraryClose(library);
+    if (rows != numBooks + numSingles) {
+        fprintf(stderr, "Read %d of %ld books\n", rows, numBooks + numSingles);
+        return 0;
+    }
+
+    printf("%-10s %14.0f %14.0f %14.0f\n", name, numBooks / batchSeconds, numSingles / singleSeconds,
+           rows / readSeconds);
+    return 1;
+}
+
+static void makeBooks(BookData* books, char (*titles)[32], char (*isbns)[14], long numBooks, const char* isbnPrefix) {
+    static const char* const authors[] = {"Ursula K. Le Guin", "J.R.R. Tolkien", "Octavia E. Butler", "Iain M. Banks"};
+    static const char* const publishers[] = {"Ace", "Allen & Unwin", "Orbit", NULL};
+    static const char* const genres[] = {"Fantasy", "Science Fiction", "Horror"};
+    static const char* const languages[] = {"English", "French"};
+
+    for (long i = 0; i < numBooks; i++) {
+        snprintf(titles[i], sizeof(titles[i]), "Book Number %ld", i);
+        snprintf(isbns[i], sizeof(isbns[i]), "%s%010ld", isbnPrefix, i);
+        books[i] = (BookData) {
+            .title = titles[i],
+            .author = (char*) authors[i % 4],
+            .publisher = (char*) publishers[i % 4],
+            .publicationDate = "2026-10-17",
+            .ISBN = isbns[i],
+            .genre = (char*) genres[i % 3],
+            .lang = (char*) languages[i % 2],
+            .numPages = (int) (100 + i % 900)
+        };
+    }
+}
+
+static void removeLibrary(void) {
+    remove(BENCH_DB);
+    remove(BENCH_DB "-journal");
+    remove(BENCH_DB "-wal");
+    remove(BENCH_DB "-shm");
+}
+
+static double secondsSince(const struct timespec* start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
@@ -0,0 +1,57 @@
+#ifndef BOOK_EXPORT_H
+#define BOOK_EXPORT_H
+
+#include "dbmanager.h"
+
+/* The file formats exportBooks can write.*/
+typedef enum {
+    /* Comma separated values with a header row, readable by importBooks*/
+    EXPORT_CSV,
+    /* One JSON object per line, readable by importBooks*/
+    EXPORT_JSONL,
+    /* The compact binary format described by BOOK_BINARY_MAGIC, the fastest
+        to read back with importBooks*/
+    EXPORT_BINARY
+} ExportFormat;
+
+/* The first bytes of a binary export. Each book follows as its seven text
+    fields in BookData order, each a 4 byte little endian length plus one
+    (0 for NULL) followed by that many bytes minus one, and then
+    numPages as a 4 byte little endian integer.*/
+#define BOOK_BINARY_MAGIC "CLMBOOK1"
+#define BOOK_BINARY_MAGIC_SIZE 8
+
+/* What happened during an export.*/
+typedef struct {
+    /* Books written*/
+    long books;
+    /* Bytes written*/
+    long long bytes;
+    /* Seconds the export took*/
+    double seconds;
+} ExportReport;
+
+/**
+ * Writes every book in a library to a file. Each row is encoded straight
+ * from sqlite's column buffers into a large output buffer, which is handed
+ * to write in one call whenever it fills, so no book is ever copied into a
+ * BookData.
+ * @param library The library to export.
+ * @param path The path of the file to write, replaced if it exists, or "-"
+ *          to write to standard output.
+ * @param format The format to write.
+ * @param report Receives the counts of the export. May be NULL.
+ * @returns OPERATION_SUCCESS if every book was written, else returns
+ *          OPERATION_FAIL.
+*/
+int exportBooks(LibraryDb* library, const char* path, ExportFormat format, ExportReport* report);
+
+/**
+ * Picks the export format from the extension of a file name.
+ * @param path The file name.
+ * @returns EXPORT_JSONL for .jsonl, .ndjson and .json files, EXPORT_BINARY for
+ *          .clmb and .bin files, else EXPORT_CSV.
+*/
+ExportFormat exportFormatForPath(const char* path);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef BOOK_IMPORT_H
+#define BOOK_IMPORT_H
+
+#include "dbmanager.h"
+
+/* The file formats importBooks can read.*/
+typedef enum {
+    /* Comma separated values. The first row names the columns, quoted fields
+        may hold commas, doubled quotes and line breaks.*/
+    IMPORT_CSV,
+    /* One flat JSON object per line, e.g. {"Title": "Dune", "NumberOfPages": 412}*/
+    IMPORT_JSONL,
+    /* The binary format written by exportBooks, see BOOK_BINARY_MAGIC*/
+    IMPORT_BINARY
+} ImportFormat;
+
+/* What happened during an import.*/
+typedef struct {
+    /* Rows read from the file, not counting the CSV header*/
+    long rowsRead;
+    /* Books added to the library*/
+    long inserted;
+    /* Rows skipped because a book with the same ISBN is already stored*/
+    long duplicates;
+    /* Rows the database rejected, e.g. an ISBN that is not 13 characters
+        or a missing title or author*/
+    long invalid;
+    /* Rows that could not be parsed*/
+    long malformed;
+    /* Seconds the import took*/
+    double seconds;
+    /* The most memory the process used, in KiB, or -1 if unknown*/
+    long peakMemoryKb;
+} ImportReport;
+
+/**
+ * Imports the books in a CSV or JSONL file into a library. The file is read
+ * in fixed size chunks and parsed as it streams in, so memory use does not
+ * depend on the size of the file. Parsed rows are inserted in batches with
+ * libraryAddBooks.
+ *
+ * CSV columns and JSONL keys are matched to BookData fields by name, ignoring case:
+ * Title, Author, Publisher, PublicationDate, ISBN, Genre, Language (or Lang)
+ * and NumberOfPages (or Pages). Other columns are ignored, and an empty
+ * value is stored as NULL. A binary file that declares a field longer than
+ * 1 MiB is rejected as corrupt.
+ *
+ * @param library The library to import into.
+ * @param path The path of the file to import.
+ * @param format The format of the file.
+ * @param report Receives the counts of the import. May be NULL.
+ * @returns OPERATION_SUCCESS if the whole file was read, even if some rows were
+ *          rejected, else returns OPERATION_FAIL. Batches inserted before a
+ *          failure stay in the library.
+*/
+int importBooks(LibraryDb* library, const char* path, ImportFormat format, ImportReport* report);
+
+/**
+ * Picks the import format from the extension of a file name.
+ * @param path The file name.
+ * @returns IMPORT_JSONL for .jsonl, .ndjson and .json files, IMPORT_BINARY for
+ *          .clmb and .bin files, else IMPORT_CSV.
+*/
+ImportFormat importFormatForPath(const char* path);
+
+#endif
@@ -4,9 +4,33 @@
 #define OPERATION_SUCCESS 1
 #define OPERATION_FAIL 0
 
+#include <stddef.h>
+#include <stdint.h>
+
+/* Number of rows addBooks inserts per transaction unless changed
+    with setBatchCommitSize.*/
+#define DEFAULT_BATCH_COMMIT_SIZE 1000
+
+/* The database file used by makeConnection*/
+#define DEFAULT_LIBRARY_PATH "data/library.db"
+
+/* Flags for libraryOpen*/
+#define LIBRARY_READWRITE 0
+#define LIBRARY_READONLY 1
+/* Keeps the ISBN of every book in an in memory hash set, so adding a book
+    with a new ISBN and hasIsbn for a missing ISBN need not ask the database.
+    A hit is confirmed by the database, and the set is reloaded when another
+    connection has committed changes since it was loaded.*/
+#define LIBRARY_ISBN_INDEX 2
+
+/* Results of nextBook*/
+#define CURSOR_ROW 1
+#define CURSOR_DONE 0
+#define CURSOR_ERROR -1
+
 /* Represents a book, contains the useful data of a book.
     All the data are strings except for the number of pages
-    "numPages" which is an integer.*/
+    "numPages" and the database id "id" which are integers.*/
 typedef struct {
     char* title;
     char* author;
@@ -16,8 +40,74 @@ typedef struct {
     char* genre;
     char* lang;
     int numPages;
+    /* The BookID of the book. Filled in when a book is read from the
+        database, ignored by addBook.*/
+    int64_t id;
 } BookData;
 
+/* A book read straight out of the database without copying it. The string
+    fields point into sqlite's own buffers for the current row and are only
+    valid until the cursor moves on. A field is NULL if the column is NULL.*/
+typedef struct {
+    const char* title;
+    const char* author;
+    const char* publisher;
+    const char* publicationDate;
+    const char* ISBN;
+    const char* genre;
+    const char* lang;
+    int numPages;
+    int64_t id;
+} BookView;
+
+/* Bits of a field mask, selecting which fields of a book a query reads.
+    The BookID is always read.*/
+#define BOOK_FIELD_TITLE (1u << 0)
+#define BOOK_FIELD_AUTHOR (1u << 1)
+#define BOOK_FIELD_PUBLISHER (1u << 2)
+#define BOOK_FIELD_PUBLICATION_DATE (1u << 3)
+#define BOOK_FIELD_ISBN (1u << 4)
+#define BOOK_FIELD_GENRE (1u << 5)
+#define BOOK_FIELD_LANG (1u << 6)
+#define BOOK_FIELD_NUM_PAGES (1u << 7)
+#define BOOK_FIELD_ALL 0xFFu
+
+/* Totals over every book in a library, see getLibraryStats.*/
+typedef struct {
+    /* Number of books*/
+    long books;
+    /* Sum of numPages over every book*/
+    long long totalPages;
+    /* Number of different authors, genres and languages. Books with no
+        genre or language are not counted as one.*/
+    long authors;
+    long genres;
+    long languages;
+} LibraryStats;
+
+/* Called by countBooksBy for each value of the grouped field.
+    @param value The value, or NULL for the books that have none.
+    @param books The number of books with the value.
+    @param pages The sum of numPages of those books.
+    @returns 0 to stop, anything else to go on to the next value.*/
+typedef int (*BookGroupVisitor)(void* context, const char* value, long books, long long pages);
+
+/* Called by forEachBook for every matching book. The view and its strings
+    are only valid until the function returns.
+    @returns 0 to stop the walk, anything else to go on to the next book.*/
+typedef int (*BookVisitor)(void* context, const BookView* book);
+
+/* Selects books by the value of their columns. A field left NULL does not
+    filter, the fields that are set must all match exactly.*/
+typedef struct {
+    const char* author;
+    const char* genre;
+    const char* lang;
+} BookFilter;
+
+/* Owns the memory of a BookArray created by getBooksArena.*/
+typedef struct BookArena BookArena;
+
 /* Holds books and the number of books.*/
 typedef struct {
     /* Holds the books and their associated data*/
@@ -26,24 +116,340 @@ typedef struct {
         @note count is used when calling freeBooks(books, count) so it is
             necessary to keep track of this number. */ 
     int count;
+    /* The arena the books and their fields were allocated from, or NULL if
+        every book and field was allocated on its own (see getBooks). An arena
+        interns the author, publisher, genre and lang fields, so books with
+        equal values share one string that must not be modified, and two of
+        these fields are equal exactly when their pointers are.*/
+    BookArena* arena;
+    /* The number of books the books array has room for. Kept so a BookArray
+        passed to reloadBooks can be refilled without reallocating.*/
+    int capacity;
 } BookArray;
 
+/* One text field of every book in a BookColumns, stored back to back. The
+    string of book i starts at data + offsets[i] and is null-terminated. A
+    NULL field takes no room at all, so offsets[i + 1] == offsets[i].*/
+typedef struct {
+    /* count + 1 offsets into data*/
+    uint32_t* offsets;
+    char* data;
+    /* Bytes of data used and allocated*/
+    size_t size;
+    size_t capacity;
+} BookColumn;
+
+/* A snapshot of books stored by column instead of by book. Each field is a
+    single array, so scanning one field of every book, e.g. every title,
+    reads memory in order instead of following two pointers per book.
+    Created by getBookColumns and released with freeBookColumns.*/
+typedef struct {
+    int count;
+    /* Room in ids, numPages and each column's offsets*/
+    int capacity;
+    int64_t* ids;
+    int32_t* numPages;
+    BookColumn title;
+    BookColumn author;
+    BookColumn publisher;
+    BookColumn publicationDate;
+    BookColumn ISBN;
+    BookColumn genre;
+    BookColumn lang;
+} BookColumns;
+
+/* An open library database, created by libraryOpen and closed with
+    libraryClose. Every handle has its own connection and statements, so
+    several libraries can be open at once and each thread can use its own
+    handle. A single handle must not be used by two threads at the same time.*/
+typedef struct LibraryDb LibraryDb;
+
+/* A query over the books table that is read one book at a time.
+    Created by openBooks and released with closeBooks.*/
+typedef struct BookCursor BookCursor;
+
+/* Settings applied to the database connection when it is made. Each field
+    maps to a sqlite PRAGMA of the same name.*/
+typedef struct {
+    /* journal_mode, e.g. "WAL" or "DELETE". NULL keeps the current mode.*/
+    const char* journalMode;
+    /* synchronous, "FULL", "NORMAL" or "OFF". NULL keeps the default.*/
+    const char* synchronous;
+    /* mmap_size in bytes, 0 turns memory mapping off and -1 keeps the default.*/
+    long long mmapSize;
+    /* cache_size, a positive number of pages or a negative number of KiB.
+        0 keeps the default.*/
+    int cacheSize;
+    /* temp_store, "DEFAULT", "FILE" or "MEMORY". NULL keeps the default.*/
+    const char* tempStore;
+    /* page_size in bytes, only applied when the database file is new.
+        0 keeps the default.*/
+    int pageSize;
+} ConnectionProfile;
+
+/* The connection profiles that come with the project, see connectionProfilePreset.*/
+typedef enum {
+    /* WAL with synchronous=FULL, every commit is synced to disk. Used by makeConnection
+        and libraryOpen. WAL is stored in the database file, so an existing library
+        in another journal mode is switched to WAL when opened and stays in it.*/
+    PROFILE_DURABLE,
+    /* WAL with synchronous=NORMAL, a larger cache and mmap. A power loss may undo
+        the last commits but cannot corrupt the database.*/
+    PROFILE_BALANCED,
+    /* WAL with synchronous=OFF and a very large cache, for imports that can be
+        re-run if they are interrupted.*/
+    PROFILE_BULK_LOAD
+} ProfilePreset;
+
+/* The outcome of inserting a single book with addBooks.*/
+typedef enum {
+    /* The book was inserted*/
+    INSERT_OK,
+    /* A book with the same ISBN is already stored*/
+    INSERT_DUPLICATE,
+    /* The book broke a CHECK or NOT NULL constraint, e.g. ISBN is not 13 characters*/
+    INSERT_INVALID,
+    /* The insert failed for another reason or was rolled back*/
+    INSERT_ERROR
+} InsertStatus;
+
+/* What upsertBook does when a book with the same ISBN is already stored.*/
+typedef enum {
+    /* Merges the new book into the stored one. Every field set in the new
+        book replaces the stored value, while NULL fields and numPages of 0
+        keep it, so a merge cannot clear a field, use updateBook for that.
+        A book that is not stored yet still needs a title and an author.*/
+    UPSERT_MERGE,
+    /* Only stored fields that are NULL, or numPages of 0, are filled in from
+        the new book.*/
+    UPSERT_FILL_MISSING,
+    /* The stored book is left as it is.*/
+    UPSERT_KEEP_EXISTING
+} UpsertPolicy;
+
+/* Counts how often the statement cache had to prepare a statement
+    and how often it reused an already prepared one.*/
+typedef struct {
+    /* Number of statements compiled with sqlite3_prepare*/
+    long prepares;
+    /* Number of times a cached statement was reused*/
+    long hits;
+} StatementCacheStats;
+
+/* Counts how many fields of a BookArray's arena were shared with an equal
+    field read before them instead of being copied.*/
+typedef struct {
+    /* Number of fields looked up in the intern table*/
+    long lookups;
+    /* Number of lookups that found an equal string already stored*/
+    long hits;
+    /* Bytes that were not copied because a stored string was shared*/
+    long long bytesSaved;
+} InternStats;
+
+/* What happened during migrateSchema.*/
+typedef struct {
+    /* Books copied into BookRecords by this run*/
+    long books;
+    /* Transactions the copy was split into*/
+    long batches;
+    /* Seconds the migration took*/
+    double seconds;
+} MigrationReport;
+
+/**
+ * Opens a library database using the PROFILE_DURABLE connection profile.
+ * Unless opened read only, also ensures the default tables are created.
+ * @note A library in another journal mode is switched to WAL, which it keeps
+ *          for later connections. Readers then need write access to the
+ *          directory for the -wal and -shm files.
+ * @param path The path of the database file, created if it does not exist
+ *          and the library is not opened read only.
+ * @param flags LIBRARY_READWRITE, or LIBRARY_READONLY to open the library
+ *          without write access. LIBRARY_ISBN_INDEX may be OR'd in to load
+ *          the ISBN index.
+ * @returns The LibraryDb handle, or NULL if the database could not be opened.
+ * @note The handle must be closed with libraryClose.
+*/
+LibraryDb* libraryOpen(const char* path, int flags);
+
+/**
+ * Opens a library database tuned with a connection profile, see libraryOpen.
+ * @param path The path of the database file.
+ * @param flags LIBRARY_READWRITE or LIBRARY_READONLY.
+ * @param profile The settings to apply to the connection, see
+ *          connectionProfilePreset. NULL uses the sqlite defaults.
+ * @returns The LibraryDb handle, or NULL if the database could not be opened.
+*/
+LibraryDb* libraryOpenEx(const char* path, int flags, const ConnectionProfile* profile);
+
+/**
+ * Closes a library database, finalizing every statement prepared on it.
+ * @param library The handle to close.
+ * @returns OPERATION_SUCCESS if close was successful else returns
+ *          OPERATION_FAIL if the handle is NULL or the database is unable
+ *          to deallocate, in which case the handle stays open.
+*/
+int libraryClose(LibraryDb* library);
+
+/**
+ * The functions below that take a LibraryDb work on that library. The
+ * functions of the same name without it, e.g. addBook for libraryAddBook,
+ * work on the default library in data/library.db opened by makeConnection.
+*/
+int libraryAddBook(LibraryDb* library, BookData data);
+int libraryAddBookWithId(LibraryDb* library, BookData data, int64_t* id);
+long libraryAddBooks(LibraryDb* library, const BookData* books, size_t numBooks, InsertStatus* statuses);
+int libraryUpsertBook(LibraryDb* library, BookData data, UpsertPolicy policy);
+void librarySetBatchCommitSize(LibraryDb* library, size_t rows);
+int libraryDeleteBookById(LibraryDb* library, int id);
+long libraryDeleteBooksByIds(LibraryDb* library, const int64_t* ids, size_t count);
+long libraryDeleteBooksWhere(LibraryDb* library, const BookFilter* filter);
+int libraryUpdateBook(LibraryDb* library, int64_t id, const BookData* changes, uint32_t fieldMask);
+int libraryHasIsbn(LibraryDb* library, const char* isbn);
+BookArray libraryGetBooks(LibraryDb* library);
+BookArray libraryGetBooksArena(LibraryDb* library);
+int libraryReloadBooks(LibraryDb* library, BookArray* array, int presize);
+int libraryGetBooksPage(LibraryDb* library, int64_t afterId, int limit, BookArray* out);
+int libraryGetBooksPageBefore(LibraryDb* library, int64_t beforeId, int limit, BookArray* out);
+int libraryGetBooksWhere(LibraryDb* library, const BookFilter* filter, BookArray* out);
+int libraryGetBookColumns(LibraryDb* library, const BookFilter* filter, BookColumns* out);
+int libraryGetBooksWhereFields(LibraryDb* library, const BookFilter* filter, uint32_t fields, BookArray* out);
+int libraryForEachBook(LibraryDb* library, BookVisitor fn, void* context, const BookFilter* filter);
+int libraryForEachBookFields(LibraryDb* library, BookVisitor fn, void* context, const BookFilter* filter, uint32_t fields);
+int libraryGetLibraryStats(LibraryDb* library, LibraryStats* out);
+int libraryRebuildStats(LibraryDb* library);
+int libraryCountBooksBy(LibraryDb* library, uint32_t field, BookGroupVisitor fn, void* context);
+int libraryRenameFieldValue(LibraryDb* library, uint32_t field, const char* from, const char* to);
+int libraryMigrateSchema(LibraryDb* library, int batchSize, MigrationReport* report);
+int librarySearchBooks(LibraryDb* library, const char* query, int limit, BookArray* out);
+BookCursor* libraryOpenBooks(LibraryDb* library);
+StatementCacheStats libraryStatementCacheStats(LibraryDb* library);
+
+/**
+ * Starts a write transaction (BEGIN IMMEDIATE) on a library so several writes
+ * are committed together with one sync to disk.
+ * @param library The library to write to.
+ * @returns OPERATION_SUCCESS if the transaction started, else returns
+ *          OPERATION_FAIL.
+ * @note Must be ended with libraryCommit or libraryRollback.
+*/
+int libraryBeginWrite(LibraryDb* library);
+
+/**
+ * Commits the transaction started by libraryBeginWrite.
+ * @returns OPERATION_SUCCESS if the transaction committed, else returns
+ *          OPERATION_FAIL and the transaction must be rolled back.
+*/
+int libraryCommit(LibraryDb* library);
+
+/**
+ * Undoes every write of the transaction started by libraryBeginWrite.
+ * @returns OPERATION_SUCCESS if the transaction was rolled back, else
+ *          returns OPERATION_FAIL.
+*/
+int libraryRollback(LibraryDb* library);
+
+/**
+ * Checks whether the transaction started by libraryBeginWrite is still open.
+ * Some errors, e.g. a full disk or an I/O error, make sqlite roll the whole
+ * transaction back on its own, after which later writes would each commit
+ * by themselves.
+ * @returns 1 if it is open, else returns 0.
+*/
+int libraryInTransaction(LibraryDb* library);
+
+/**
+ * Gets the handle of the default library opened by makeConnection, so it can
+ * be passed to the functions that take a LibraryDb.
+ * @returns The default library, or NULL if makeConnection has not been called.
+*/
+LibraryDb* getDefaultLibrary(void);
+
 /**
- * Creates a connection to the sqlite database. Also ensures the
- * default tables are created.
+ * Creates a connection to the sqlite database using the PROFILE_DURABLE
+ * connection profile. Also ensures the default tables are created and loads
+ * the ISBN index (see LIBRARY_ISBN_INDEX).
+ * @note Like libraryOpen, this switches a library in another journal mode to WAL.
  * @returns OPERATION_SUCCESS if connection was successful and
  *          returns OPERATION_FAIL if failed to connect.
 */
 int makeConnection(void);
 
 /**
- * Inserts book data into the database.
+ * Creates a connection to the sqlite database tuned with a connection profile.
+ * Also ensures the default tables are created and loads the ISBN index.
+ * @param profile The settings to apply to the connection, see
+ *          connectionProfilePreset. NULL uses the sqlite defaults.
+ * @returns OPERATION_SUCCESS if connection was successful and
+ *          returns OPERATION_FAIL if failed to connect.
+ * @note If a connection already exists it is kept as is and the profile
+ *          is not applied.
+*/
+int makeConnectionEx(const ConnectionProfile* profile);
+
+/**
+ * Gets the settings of one of the preset connection profiles.
+ * @param preset The preset wanted.
+ * @returns The ConnectionProfile of the preset, which may be changed before
+ *          passing it to makeConnectionEx.
+*/
+ConnectionProfile connectionProfilePreset(ProfilePreset preset);
+
+/**
+ * Inserts book data into the database. If the ISBN index is loaded, a book
+ * whose ISBN is already stored is rejected without touching the database.
  * @param data The BookData to be inserted
  * @returns OPERATION_SUCCESS if data was inserted successfully,
  *          else returns OPERATION_FAIL.
 */
 int addBook(BookData data);
 
+/**
+ * Inserts book data into the database and gets the id it was stored under.
+ * @param data The BookData to be inserted
+ * @param id Receives the BookID of the new book if the insert succeeded.
+ *          May be NULL.
+ * @returns OPERATION_SUCCESS if data was inserted successfully,
+ *          else returns OPERATION_FAIL.
+*/
+int addBookWithId(BookData data, int64_t* id);
+
+/**
+ * Inserts many books into the database. The books are inserted with one
+ * reused statement inside BEGIN IMMEDIATE/COMMIT transactions, committing
+ * every batch commit size rows (see setBatchCommitSize). A row that breaks
+ * a constraint is skipped without aborting the rest of the batch.
+ * 
+ * @param books The array of BookData to be inserted.
+ * @param numBooks The number of books in the array.
+ * @param statuses Optional array of numBooks entries that receives the
+ *          InsertStatus of each row. May be NULL.
+ * @returns The number of books inserted, or -1 if a database error stopped
+ *          the batch. Chunks committed before the error stay inserted, the
+ *          rows of the failed chunk and after it are marked INSERT_ERROR.
+*/
+long addBooks(const BookData* books, size_t numBooks, InsertStatus* statuses);
+
+/**
+ * Inserts a book, or updates the stored book with the same ISBN, in a single
+ * statement (INSERT ... ON CONFLICT(ISBN) DO UPDATE). Meant for re-syncing
+ * book data from an outside source.
+ * @param data The book to insert. Without an ISBN it is always inserted.
+ * @param policy How the fields of a stored book are updated.
+ * @returns OPERATION_SUCCESS if the book was inserted, updated or kept, else
+ *          returns OPERATION_FAIL.
+*/
+int upsertBook(BookData data, UpsertPolicy policy);
+
+/**
+ * Sets how many rows addBooks inserts before committing a transaction.
+ * Larger chunks mean fewer syncs to disk but a longer held write lock.
+ * @param rows The number of rows per transaction. 0 restores
+ *          DEFAULT_BATCH_COMMIT_SIZE.
+*/
+void setBatchCommitSize(size_t rows);
+
 /**
  * Deletes a book from the database with a given id.
  * @param id The id of the book to be deleted from the database
@@ -52,6 +458,48 @@ int addBook(BookData data);
 */
 int deleteBookById(int id);
 
+/**
+ * Deletes many books at once. The ids are loaded into a temporary table and
+ * the books are deleted with a single statement inside one transaction.
+ * @param ids The BookIDs of the books to delete. Ids with no book are skipped.
+ * @param count The number of ids.
+ * @returns The number of books deleted, or -1 if the delete failed, in which
+ *          case no book was deleted.
+*/
+long deleteBooksByIds(const int64_t* ids, size_t count);
+
+/**
+ * Deletes every book matching a filter with a single statement, e.g. every
+ * book of a genre.
+ * @param filter The filter the books must match. At least one field must be
+ *          set, so all the books are never deleted by mistake.
+ * @returns The number of books deleted, or -1 if the delete failed.
+*/
+long deleteBooksWhere(const BookFilter* filter);
+
+/**
+ * Changes some of the fields of a stored book. Only the columns in the mask
+ * are written, so the book keeps its BookID and the indexes of the other
+ * columns are not touched.
+ * @param id The BookID of the book to change.
+ * @param changes The new values. Only the fields in fieldMask are read.
+ * @param fieldMask The BOOK_FIELD_* bits of the fields to change.
+ * @returns OPERATION_SUCCESS if the book was changed, else returns
+ *          OPERATION_FAIL, e.g. when no book has the id, the mask is empty
+ *          or the new ISBN belongs to another book.
+*/
+int updateBook(int64_t id, const BookData* changes, uint32_t fieldMask);
+
+/**
+ * Checks whether a book with an ISBN is stored. With the ISBN index loaded
+ * an ISBN that is not stored is found by a hash lookup, otherwise the
+ * database is asked.
+ * @param isbn The ISBN to look for.
+ * @returns 1 if a book has the ISBN, 0 if none does, or -1 if the database
+ *          could not be asked.
+*/
+int hasIsbn(const char* isbn);
+
 /**
  * Gets all the books inside of the database. A row inside the database
  * table is represented by BookData, think of BookData as just a book.
@@ -76,6 +524,296 @@ int deleteBookById(int id);
 */
 BookArray getBooks(void);
 
+/**
+ * Gets all the books inside of the database, the same as getBooks, except
+ * that every book and field is allocated from an arena. The arena takes
+ * memory in a few large chunks instead of one allocation per book and per
+ * field, so loading is cheaper, the BookData structs sit next to each other
+ * in memory, and freeing costs one free per chunk.
+ * 
+ * @returns A BookArray with its arena set. On error the books are NULL and
+ *          the count is -1.
+ * 
+ * @note The books must be freed by calling freeBookArray, not freeBooks.
+*/
+BookArray getBooksArena(void);
+
+/**
+ * Refills a BookArray with all the books inside of the database. The books
+ * the array already holds are freed, but its books array is kept and only
+ * grown if the new books do not fit, and an arena keeps its chunks. This lets
+ * a view refresh the same BookArray over and over without reallocating.
+ * 
+ * @param array The BookArray to refill. Must come from getBooks or
+ *          getBooksArena, or be zero initialised for a malloc backed array.
+ * @param presize If not 0 the books are counted with SELECT COUNT(*) first so
+ *          the books array is sized once instead of grown while reading.
+ * @returns OPERATION_SUCCESS if the books were read, else returns
+ *          OPERATION_FAIL and the array is left holding no books.
+ * 
+ * @note The array must still be freed with freeBookArray.
+*/
+int reloadBooks(BookArray* array, int presize);
+
+/**
+ * Gets one page of books ordered by BookID, starting after a given id. The
+ * query seeks straight to afterId through the primary key, so every page
+ * costs the same no matter how far into the library it is.
+ * 
+ * @param afterId The id of the last book of the previous page. Pass 0 to
+ *          get the first page.
+ * @param limit The most books the page can hold, must be at least 1.
+ * @param out The BookArray that receives the page, replacing the books it
+ *          holds. Its books array is reused like with reloadBooks.
+ * @returns OPERATION_SUCCESS if the page was read, else returns
+ *          OPERATION_FAIL. A page with fewer than limit books is the last one.
+ * 
+ * @note The next page starts after out->books[out->count - 1]->id.
+*/
+int getBooksPage(int64_t afterId, int limit, BookArray* out);
+
+/**
+ * Gets one page of books ordered by BookID, ending before a given id. This
+ * is the reverse of getBooksPage for paging backward.
+ * 
+ * @param beforeId The id of the first book of the page after this one. Pass
+ *          INT64_MAX to get the last page.
+ * @param limit The most books the page can hold, must be at least 1.
+ * @param out The BookArray that receives the page, replacing the books it
+ *          holds. The books are still in ascending BookID order.
+ * @returns OPERATION_SUCCESS if the page was read, else returns
+ *          OPERATION_FAIL.
+*/
+int getBooksPageBefore(int64_t beforeId, int limit, BookArray* out);
+
+/**
+ * Gets the books inside of the database that match a filter, ordered by
+ * BookID. The filtering happens inside the database using the indexes on
+ * Author, Genre and Language, so only the matching books are read.
+ * 
+ * @param filter The filter the books must match. NULL, or a filter with every
+ *          field NULL, gets all the books.
+ * @param out The BookArray that receives the books, replacing the books it
+ *          holds. Its books array is reused like with reloadBooks.
+ * @returns OPERATION_SUCCESS if the query ran, else returns OPERATION_FAIL.
+*/
+int getBooksWhere(const BookFilter* filter, BookArray* out);
+
+/**
+ * Gets the books that match a filter like getBooksWhere, but reads only some
+ * of their fields. The query selects just those columns, so a list that
+ * shows titles and authors does not copy the rest of every book, and when an
+ * index holds every column asked for sqlite can answer from the index alone.
+ * 
+ * @param filter The filter the books must match. NULL gets all the books.
+ * @param fields The BOOK_FIELD_* bits of the fields to read. Fields not asked
+ *          for are NULL, or 0 for numPages.
+ * @param out The BookArray that receives the books, see getBooksWhere.
+ * @returns OPERATION_SUCCESS if the query ran, else returns OPERATION_FAIL.
+*/
+int getBooksWhereFields(const BookFilter* filter, uint32_t fields, BookArray* out);
+
+/**
+ * Calls a function for every book inside of the database that matches a
+ * filter, ordered by BookID. Each book is handed over as a BookView pointing
+ * at sqlite's own row buffers, so walking the books allocates nothing, which
+ * suits callers that only look at each book once such as printing or
+ * counting.
+ * 
+ * @param fn The function called for each book. It may use the library,
+ *          including calling forEachBook again.
+ * @param context Passed to fn.
+ * @param filter The filter the books must match. NULL gets all the books.
+ * @returns OPERATION_SUCCESS if every book was visited or fn stopped the walk,
+ *          else returns OPERATION_FAIL.
+*/
+int forEachBook(BookVisitor fn, void* context, const BookFilter* filter);
+
+/**
+ * Visits the books that match a filter like forEachBook, but reads only the
+ * fields in a BOOK_FIELD_* mask. Fields not asked for are NULL, or 0 for
+ * numPages.
+*/
+int forEachBookFields(BookVisitor fn, void* context, const BookFilter* filter, uint32_t fields);
+
+/**
+ * Gets the totals of the library. They are read from the LibraryStats table,
+ * which triggers on the Books table keep up to date, so the cost does not
+ * depend on the number of books.
+ * @param out Receives the totals.
+ * @returns OPERATION_SUCCESS if the totals were read, else returns OPERATION_FAIL.
+*/
+int getLibraryStats(LibraryStats* out);
+
+/**
+ * Recounts the LibraryStats table from the Books table, for when it has
+ * drifted, e.g. after the triggers were dropped or the file was edited by
+ * another program. In a normalized library it also removes the authors,
+ * publishers, genres and languages that no book has, which writes made by
+ * other programs through the Books view can leave behind.
+ * @returns OPERATION_SUCCESS if the counts were rebuilt, else returns OPERATION_FAIL.
+*/
+int rebuildStats(void);
+
+/**
+ * Counts the books and pages for each value of a field, most books first,
+ * e.g. the top genres. The counts are read from the LibraryStats table, see
+ * getLibraryStats, so the cost depends on the number of values and not on
+ * the number of books.
+ * @param field BOOK_FIELD_AUTHOR, BOOK_FIELD_GENRE or BOOK_FIELD_LANG.
+ * @param fn Called for each value.
+ * @param context Passed to fn.
+ * @returns OPERATION_SUCCESS if every value was visited or fn stopped early,
+ *          else returns OPERATION_FAIL.
+*/
+int countBooksBy(uint32_t field, BookGroupVisitor fn, void* context);
+
+/**
+ * Renames an author, publisher, genre or language on every book that has it.
+ * In a normalized library this updates the one row of the name table, plus
+ * the search index of the books that have it. If the new name is already
+ * used, or the library is not normalized, each of those books is rewritten,
+ * and the old name is removed from the name table.
+ * @param field BOOK_FIELD_AUTHOR, BOOK_FIELD_PUBLISHER, BOOK_FIELD_GENRE or
+ *          BOOK_FIELD_LANG.
+ * @param from The current name.
+ * @param to The new name.
+ * @returns OPERATION_SUCCESS if the rename ran, even if no book has the
+ *          name, else returns OPERATION_FAIL.
+*/
+int renameFieldValue(uint32_t field, const char* from, const char* to);
+
+/**
+ * Migrates a library made before the schema was normalized. The Books table
+ * is copied into BookRecords, which holds the id of each author, publisher,
+ * genre and language instead of its text, and then replaced by a Books view
+ * with the same columns, so reads and older programs keep working. New
+ * libraries are created normalized.
+ * 
+ * The copy runs in transactions of batchSize books and triggers copy every
+ * write made to Books meanwhile, so other connections keep reading and
+ * writing while it runs. Only the final swap holds the write lock for
+ * longer, while it checks the copy and drops the Books table. If stopped,
+ * the migration can be run again and picks up the tables it left. The pages
+ * of the dropped table are kept free for later books, VACUUM returns them
+ * to the file system.
+ * 
+ * @param batchSize The most books copied per transaction, 0 for the batch
+ *          commit size of addBooks.
+ * @param report Receives the counts of the migration. May be NULL.
+ * @returns OPERATION_SUCCESS if the library is normalized, including when it
+ *          already was, else returns OPERATION_FAIL.
+ * 
+ * @note Other handles open on the library notice the migration at their
+ *          next write and prepare their statements again. A handle whose
+ *          forEachBook visitor is running waits for the visit to end before
+ *          it switches, until then its upsertBook fails, as a view cannot
+ *          be upserted into.
+*/
+int migrateSchema(int batchSize, MigrationReport* report);
+
+/**
+ * Searches the books inside of the database by their title, author,
+ * publisher and genre. The search goes through a full-text index, so it
+ * stays fast for large libraries, and the best matches (ranked by bm25)
+ * come first.
+ * 
+ * @param query The words to search for, as typed by the user. Every word
+ *          must appear in the book, and the last word may be the start of
+ *          a longer word, e.g. "tolkien hob" finds The Hobbit.
+ * @param limit The most books to return, must be at least 1.
+ * @param out The BookArray that receives the matching books, replacing the
+ *          books it holds. Its books array is reused like with reloadBooks.
+ * @returns OPERATION_SUCCESS if the search ran, even if no books matched,
+ *          else returns OPERATION_FAIL.
+*/
+int searchLocalBooks(const char* query, int limit, BookArray* out);
+
+/**
+ * Frees a BookArray created by getBooks or getBooksArena and resets it to
+ * an empty array.
+ * @param array The BookArray to free.
+*/
+void freeBookArray(BookArray* array);
+
+/**
+ * Gets the counters of the string interning done while filling an arena
+ * backed BookArray. The hit rate is hits divided by lookups.
+ * @param array The BookArray, from getBooksArena or refilled since.
+ * @returns The counters for the books the array holds, all 0 if the array
+ *          has no arena.
+*/
+InternStats getBookArrayInternStats(const BookArray* array);
+
+/**
+ * Takes a snapshot of the books matching a filter, ordered by BookID, stored
+ * by column (see BookColumns).
+ * @param filter The filter the books must match. NULL gets all the books.
+ * @param out The BookColumns that receives the books, replacing the books it
+ *          holds. Its arrays are reused, so taking a new snapshot into the
+ *          same BookColumns only allocates when it grows. Zero it before its
+ *          first use.
+ * @returns OPERATION_SUCCESS if the snapshot was taken, else returns
+ *          OPERATION_FAIL and out holds no books.
+*/
+int getBookColumns(const BookFilter* filter, BookColumns* out);
+
+/**
+ * Gets the text of one book in a column of a BookColumns.
+ * @param column The column, e.g. &columns.title.
+ * @param row The index of the book, from 0 to count - 1.
+ * @returns The text, or NULL if the field is NULL for this book.
+*/
+const char* bookColumnText(const BookColumn* column, int row);
+
+/**
+ * Frees the arrays of a BookColumns and resets it to no books.
+ * @param columns The BookColumns to free.
+*/
+void freeBookColumns(BookColumns* columns);
+
+/**
+ * Opens a cursor over all the books inside of the database. Unlike getBooks
+ * nothing is loaded up front, each book is read from the database when
+ * nextBook is called, so the first book is available right away and memory
+ * use does not grow with the size of the library.
+ * 
+ * @returns A BookCursor positioned before the first book, or NULL if the
+ *          query could not be started.
+ * 
+ * @note The cursor must be released with closeBooks.
+*/
+BookCursor* openBooks(void);
+
+/**
+ * Reads the next book from a cursor.
+ * @param cursor The cursor created with openBooks.
+ * @param out Receives the book. Its string fields point into buffers owned by
+ *          the cursor and stay valid only until the next call to nextBook or
+ *          closeBooks. A field is NULL if the column is NULL in the database.
+ * @returns CURSOR_ROW if a book was read into out, CURSOR_DONE if there are
+ *          no more books, or CURSOR_ERROR if the read failed.
+*/
+int nextBook(BookCursor* cursor, BookData* out);
+
+/**
+ * Reads the next book from a cursor without copying it, for callers that
+ * only look at each book once, e.g. to write it out.
+ * @param cursor The cursor created with openBooks.
+ * @param out Receives the book. Its string fields point into the row sqlite
+ *          is holding and stay valid only until the next call to nextBook,
+ *          nextBookView or closeBooks.
+ * @returns CURSOR_ROW if a book was read into out, CURSOR_DONE if there are
+ *          no more books, or CURSOR_ERROR if the read failed.
+*/
+int nextBookView(BookCursor* cursor, BookView* out);
+
+/**
+ * Releases a cursor and the buffers it owns.
+ * @param cursor The cursor created with openBooks. May be NULL.
+*/
+void closeBooks(BookCursor* cursor);
+
 /**
  * Frees all the memeory allocated to BookData and it's fields.
  * @param books The array of BookData that is created when calling getBooks().
@@ -83,6 +821,15 @@ BookArray getBooks(void);
 */
 void freeBooks(BookData** books, int numBooks);
 
+/**
+ * Gets the counters of the prepared statement cache. The cache holds the
+ * statements used by addBook, deleteBookById and getBooks so their SQL is
+ * only compiled once per connection.
+ * @returns A StatementCacheStats struct with the number of prepares and
+ *          cache hits since the program started.
+*/
+StatementCacheStats getStatementCacheStats(void);
+
 /**
  * Closes the connection to the sqlite database.
  * @returns OPERATION_SUCCESS if close was successful else
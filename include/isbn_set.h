@@ -0,0 +1,61 @@
+#ifndef ISBN_SET_H
+#define ISBN_SET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* A set of ISBNs held in memory. Each 13 digit ISBN is packed into a 64 bit
+    integer and stored in an open addressing hash table with linear probing,
+    so a lookup is a hash and usually a single memory read.*/
+typedef struct IsbnSet IsbnSet;
+
+/**
+ * Packs a 13 digit ISBN into an integer key.
+ * @param isbn The ISBN. May be NULL.
+ * @param key Receives the key.
+ * @returns 1 if the ISBN is exactly 13 digits and was packed, else returns 0.
+*/
+int isbnPack(const char* isbn, uint64_t* key);
+
+/**
+ * Creates an empty set.
+ * @param expected The number of ISBNs the set should hold without growing.
+ * @returns The set, or NULL if it could not be allocated.
+ * @note The set must be freed with isbnSetFree.
+*/
+IsbnSet* isbnSetCreate(size_t expected);
+
+/**
+ * Adds a key to a set, growing it when it is half full.
+ * @returns 1 if the key is in the set, else returns 0 if it could not grow.
+*/
+int isbnSetAdd(IsbnSet* set, uint64_t key);
+
+/**
+ * Removes a key from a set. Does nothing if the key is not in the set.
+*/
+void isbnSetRemove(IsbnSet* set, uint64_t key);
+
+/**
+ * Checks whether a key is in a set.
+ * @returns 1 if it is, else returns 0.
+*/
+int isbnSetContains(const IsbnSet* set, uint64_t key);
+
+/**
+ * Empties a set, keeping its table.
+*/
+void isbnSetClear(IsbnSet* set);
+
+/**
+ * Gets the number of keys in a set.
+*/
+size_t isbnSetCount(const IsbnSet* set);
+
+/**
+ * Frees a set.
+ * @param set The set to free. May be NULL.
+*/
+void isbnSetFree(IsbnSet* set);
+
+#endif
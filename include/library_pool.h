@@ -0,0 +1,65 @@
+#ifndef LIBRARY_POOL_H
+#define LIBRARY_POOL_H
+
+#include "dbmanager.h"
+
+/* A set of connections to one library: a fixed number of read only
+    connections shared by reader threads, and a single writer connection.
+    Uses WAL journaling so readers keep reading while the writer commits,
+    each query reading from the snapshot of the last commit before it began.*/
+typedef struct LibraryPool LibraryPool;
+
+/**
+ * Opens the writer connection and all the reader connections of a pool.
+ * Every connection is opened up front so checking one out never waits on
+ * the disk.
+ * @param path The path of the database file, created if it does not exist.
+ * @param readers The number of read only connections, at least 1.
+ * @param profile The settings applied to every connection, see
+ *          connectionProfilePreset. The journal mode is always WAL.
+ *          NULL uses PROFILE_BALANCED.
+ * @returns The pool, or NULL if any connection could not be opened.
+ * @note The pool must be closed with libraryPoolClose.
+*/
+LibraryPool* libraryPoolOpen(const char* path, int readers, const ConnectionProfile* profile);
+
+/**
+ * Takes a read only connection from the pool, waiting until one is free.
+ * @param pool The pool.
+ * @returns A read only LibraryDb for use by the calling thread only. It must
+ *          be handed back with libraryPoolCheckin.
+*/
+LibraryDb* libraryPoolCheckout(LibraryPool* pool);
+
+/**
+ * Hands a read only connection back to the pool.
+ * @param pool The pool the connection came from.
+ * @param reader The connection from libraryPoolCheckout. Any cursor opened on
+ *          it must be closed first.
+*/
+void libraryPoolCheckin(LibraryPool* pool, LibraryDb* reader);
+
+/**
+ * Takes the writer connection of the pool, waiting until no other thread
+ * holds it. Only one thread writes at a time.
+ * @param pool The pool.
+ * @returns The writer LibraryDb. It must be handed back with
+ *          libraryPoolCheckinWriter.
+*/
+LibraryDb* libraryPoolCheckoutWriter(LibraryPool* pool);
+
+/**
+ * Hands the writer connection back to the pool.
+ * @param pool The pool the writer came from.
+*/
+void libraryPoolCheckinWriter(LibraryPool* pool);
+
+/**
+ * Closes every connection of a pool.
+ * @param pool The pool to close. No connection may be checked out.
+ * @returns OPERATION_SUCCESS if every connection closed, else returns
+ *          OPERATION_FAIL.
+*/
+int libraryPoolClose(LibraryPool* pool);
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef WRITE_QUEUE_H
+#define WRITE_QUEUE_H
+
+#include "dbmanager.h"
+
+/* Writes books on a background thread. Adds and deletes are pushed onto a
+    lock-free queue and return straight away, and the writer thread commits
+    everything waiting in the queue inside one transaction, so a burst of
+    writes costs one sync to disk instead of one per write.*/
+typedef struct WriteQueue WriteQueue;
+
+/**
+ * Called on the writer thread once a queued write is committed or has failed.
+ * @param context The context passed when the write was queued.
+ * @param result OPERATION_SUCCESS if the write was committed, else
+ *          OPERATION_FAIL.
+ * @param id The BookID of the new book for an add, or the id of the deleted
+ *          book for a delete.
+*/
+typedef void (*WriteCallback)(void* context, int result, int64_t id);
+
+/**
+ * Starts a writer thread with its own connection to a library.
+ * @param path The path of the database file, created if it does not exist.
+ * @param profile The settings for the writer connection, see
+ *          connectionProfilePreset. NULL uses PROFILE_DURABLE.
+ * @returns The queue, or NULL if the connection or thread could not be made.
+ * @note The queue must be stopped with writeQueueStop.
+*/
+WriteQueue* writeQueueStart(const char* path, const ConnectionProfile* profile);
+
+/**
+ * Queues a book to be inserted. Safe to call from any thread.
+ * @param queue The queue.
+ * @param data The book to insert. Its strings are copied, so it does not
+ *          need to outlive the call.
+ * @param callback Called once the book is committed or failed. May be NULL.
+ * @param context Passed to the callback.
+ * @returns OPERATION_SUCCESS if the book was queued, else returns
+ *          OPERATION_FAIL and the callback is never called.
+*/
+int writeQueueAddBook(WriteQueue* queue, const BookData* data, WriteCallback callback, void* context);
+
+/**
+ * Queues a book to be deleted. Safe to call from any thread.
+ * @param queue The queue.
+ * @param id The id of the book to delete, must be at least 1.
+ * @param callback Called once the delete is committed or failed. May be NULL.
+ * @param context Passed to the callback.
+ * @returns OPERATION_SUCCESS if the delete was queued, else returns
+ *          OPERATION_FAIL and the callback is never called.
+*/
+int writeQueueDeleteBook(WriteQueue* queue, int id, WriteCallback callback, void* context);
+
+/**
+ * Waits until every write queued before this call has been committed or
+ * has failed, and its callback has returned.
+ * @param queue The queue.
+*/
+void writeQueueFlush(WriteQueue* queue);
+
+/**
+ * Commits everything still queued, stops the writer thread and closes its
+ * connection.
+ * @param queue The queue to stop. No writes may be queued during or after the call.
+ * @returns OPERATION_SUCCESS if the connection closed, else returns OPERATION_FAIL.
+*/
+int writeQueueStop(WriteQueue* queue);
+
+/**
+ * Starts the write queue used by addBookAsync and deleteBookByIdAsync, on the
+ * same database file as makeConnection.
+ * @returns OPERATION_SUCCESS if the queue is running, else returns OPERATION_FAIL.
+*/
+int startAsyncWrites(void);
+
+/**
+ * Queues a book to be inserted by the queue from startAsyncWrites, see
+ * writeQueueAddBook.
+*/
+int addBookAsync(BookData data, WriteCallback callback, void* context);
+
+/**
+ * Queues a book to be deleted by the queue from startAsyncWrites, see
+ * writeQueueDeleteBook.
+*/
+int deleteBookByIdAsync(int id, WriteCallback callback, void* context);
+
+/**
+ * Commits everything queued and stops the queue from startAsyncWrites.
+ * @returns OPERATION_SUCCESS if it was stopped, else returns OPERATION_FAIL.
+*/
+int stopAsyncWrites(void);
+
+#endif
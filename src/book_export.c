@@ -0,0 +1,334 @@
+/**
+ * File: book_export.c
+ * 
+ * Project: CLManager
+ * 
+ * Author: Issiah J Banda
+ * 
+ * Date Of Creation: 2026-10-17 //YYYY-MM-DD
+ * 
+ * Description: Exports books to CSV, JSONL and a compact binary format. Rows are
+ *              read without copying and encoded into one large buffer that is
+ *              written to the file a chunk at a time.
+ * 
+ * Modification History:
+ *      - 2026-10-17: Created the streaming exporter.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "book_export.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/* Size of the buffer rows are encoded into before it is written out.*/
+#define OUTPUT_BUFFER_SIZE (1024 * 1024)
+
+/* The number of string fields inside BookView.*/
+#define TEXT_FIELDS 7
+
+/* The column names written in the CSV header and as JSONL keys, in BookView
+    order. They are the names importBooks looks for.*/
+static const char* const fieldNames[] = {
+    "Title", "Author", "Publisher", "PublicationDate", "ISBN", "Genre", "Language", "NumberOfPages"
+};
+
+typedef struct {
+    int fd;
+    char* buffer;
+    size_t used;
+    long long bytes;
+    /* Set once a write fails, later output is dropped*/
+    int failed;
+} Output;
+
+/**
+ * Writes the buffered output to the file.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int flushOutput(Output* output);
+/**
+ * Appends bytes to the output, flushing the buffer when it fills.
+*/
+static void putBytes(Output* output, const char* data, size_t length);
+/**
+ * Appends one byte to the output.
+*/
+static void putChar(Output* output, char c);
+/**
+ * Appends a number as decimal text.
+*/
+static void putNumber(Output* output, long long number);
+/**
+ * Appends a 4 byte little endian integer.
+*/
+static void putUint32(Output* output, uint32_t value);
+/**
+ * Writes a book as a CSV record.
+*/
+static void writeCsv(Output* output, const BookView* book);
+/**
+ * Writes a book as a JSON object on its own line.
+*/
+static void writeJson(Output* output, const BookView* book);
+/**
+ * Writes a book as a binary record, see BOOK_BINARY_MAGIC.
+*/
+static void writeBinary(Output* output, const BookView* book);
+/**
+ * Puts the text fields of a book into an array, in BookView order.
+*/
+static void viewFields(const BookView* book, const char* fields[TEXT_FIELDS]);
+
+int exportBooks(LibraryDb* library, const char* path, ExportFormat format, ExportReport* report) {
+    ExportReport localReport;
+    if (report == NULL) {
+        report = &localReport;
+    }
+    memset(report, 0, sizeof(ExportReport));
+    if (library == NULL || path == NULL) {
+        return OPERATION_FAIL;
+    }
+
+    Output output = {0};
+    output.fd = strcmp(path, "-") == 0 ? STDOUT_FILENO : open(path, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+    if (output.fd < 0) {
+        fprintf(stderr, "Cannot open export file: %s\n", path);
+        return OPERATION_FAIL;
+    }
+    output.buffer = malloc(OUTPUT_BUFFER_SIZE);
+    BookCursor* cursor = output.buffer != NULL ? libraryOpenBooks(library) : NULL;
+    if (cursor == NULL) {
+        if (output.buffer == NULL) {
+            fprintf(stderr, "Error Allocating Memory in exportBooks\n");
+        }
+        free(output.buffer);
+        if (output.fd != STDOUT_FILENO) {
+            close(output.fd);
+        }
+        return OPERATION_FAIL;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (format == EXPORT_CSV) {
+        for (int i = 0; i <= TEXT_FIELDS; i++) {
+            if (i > 0) {
+                putChar(&output, ',');
+            }
+            putBytes(&output, fieldNames[i], strlen(fieldNames[i]));
+        }
+        putChar(&output, '\n');
+    } else if (format == EXPORT_BINARY) {
+        putBytes(&output, BOOK_BINARY_MAGIC, BOOK_BINARY_MAGIC_SIZE);
+    }
+
+    BookView book;
+    int rc = CURSOR_ERROR;
+    while (!output.failed && (rc = nextBookView(cursor, &book)) == CURSOR_ROW) {
+        switch (format) {
+            case EXPORT_CSV: writeCsv(&output, &book); break;
+            case EXPORT_JSONL: writeJson(&output, &book); break;
+            case EXPORT_BINARY: writeBinary(&output, &book); break;
+        }
+        report->books++;
+    }
+    closeBooks(cursor);
+    flushOutput(&output);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    report->seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    report->bytes = output.bytes;
+
+    free(output.buffer);
+    if (output.fd != STDOUT_FILENO && close(output.fd) != 0) {
+        output.failed = 1;
+    }
+    if (output.failed) {
+        fprintf(stderr, "Error writing export file: %s\n", path);
+        return OPERATION_FAIL;
+    }
+    return rc == CURSOR_DONE ? OPERATION_SUCCESS : OPERATION_FAIL;
+}
+
+ExportFormat exportFormatForPath(const char* path) {
+    const char* extension = path != NULL ? strrchr(path, '.') : NULL;
+    if (extension == NULL) {
+        return EXPORT_CSV;
+    }
+    if (strcasecmp(extension, ".jsonl") == 0 || strcasecmp(extension, ".ndjson") == 0 ||
+        strcasecmp(extension, ".json") == 0) {
+        return EXPORT_JSONL;
+    }
+    if (strcasecmp(extension, ".clmb") == 0 || strcasecmp(extension, ".bin") == 0) {
+        return EXPORT_BINARY;
+    }
+    return EXPORT_CSV;
+}
+
+static int flushOutput(Output* output) {
+    size_t written = 0;
+    while (!output->failed && written < output->used) {
+        ssize_t n = write(output->fd, output->buffer + written, output->used - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            output->failed = 1;
+            break;
+        }
+        written += n;
+    }
+    output->bytes += written;
+    output->used = 0;
+    return !output->failed;
+}
+
+static void putBytes(Output* output, const char* data, size_t length) {
+    while (length > 0) {
+        if (output->used == OUTPUT_BUFFER_SIZE && !flushOutput(output)) {
+            return;
+        }
+        size_t room = OUTPUT_BUFFER_SIZE - output->used;
+        size_t n = length < room ? length : room;
+        memcpy(output->buffer + output->used, data, n);
+        output->used += n;
+        data += n;
+        length -= n;
+    }
+}
+
+static void putChar(Output* output, char c) {
+    if (output->used == OUTPUT_BUFFER_SIZE && !flushOutput(output)) {
+        return;
+    }
+    output->buffer[output->used++] = c;
+}
+
+static void putNumber(Output* output, long long number) {
+    char text[24];
+    int length = snprintf(text, sizeof(text), "%lld", number);
+    putBytes(output, text, length);
+}
+
+static void putUint32(Output* output, uint32_t value) {
+    char bytes[4] = {
+        (char) (value & 0xFF), (char) ((value >> 8) & 0xFF),
+        (char) ((value >> 16) & 0xFF), (char) ((value >> 24) & 0xFF)
+    };
+    putBytes(output, bytes, 4);
+}
+
+static void writeCsv(Output* output, const BookView* book) {
+    const char* fields[TEXT_FIELDS];
+    viewFields(book, fields);
+
+    for (int i = 0; i < TEXT_FIELDS; i++) {
+        const char* text = fields[i];
+        if (text != NULL) {
+            // Only quote fields that need it, most fields are copied as is
+            size_t length = strlen(text);
+            if (strpbrk(text, ",\"\r\n") == NULL) {
+                putBytes(output, text, length);
+            } else {
+                putChar(output, '"');
+                for (const char* quote; (quote = strchr(text, '"')) != NULL; text = quote + 1) {
+                    putBytes(output, text, quote - text + 1);
+                    putChar(output, '"'); // Double every quote
+                }
+                putBytes(output, text, strlen(text));
+                putChar(output, '"');
+            }
+        }
+        putChar(output, ',');
+    }
+    putNumber(output, book->numPages);
+    putChar(output, '\n');
+}
+
+static void writeJson(Output* output, const BookView* book) {
+    static const char hex[] = "0123456789abcdef";
+    const char* fields[TEXT_FIELDS];
+    viewFields(book, fields);
+
+    putChar(output, '{');
+    for (int i = 0; i < TEXT_FIELDS; i++) {
+        putChar(output, '"');
+        putBytes(output, fieldNames[i], strlen(fieldNames[i]));
+        putBytes(output, "\": ", 3);
+        if (fields[i] == NULL) {
+            putBytes(output, "null, ", 6);
+            continue;
+        }
+
+        putChar(output, '"');
+        const char* run = fields[i];
+        for (const char* c = fields[i]; ; c++) {
+            unsigned char byte = (unsigned char) *c;
+            if (byte != '\0' && byte != '"' && byte != '\\' && byte >= 0x20) {
+                continue;
+            }
+            // Copy the plain text before the byte in one go
+            putBytes(output, run, c - run);
+            run = c + 1;
+            if (byte == '\0') {
+                break;
+            }
+            putChar(output, '\\');
+            switch (byte) {
+                case '"': putChar(output, '"'); break;
+                case '\\': putChar(output, '\\'); break;
+                case '\n': putChar(output, 'n'); break;
+                case '\r': putChar(output, 'r'); break;
+                case '\t': putChar(output, 't'); break;
+                default: {
+                    char escape[5] = {'u', '0', '0', hex[byte >> 4], hex[byte & 0xF]};
+                    putBytes(output, escape, 5);
+                    break;
+                }
+            }
+        }
+        putBytes(output, "\", ", 3);
+    }
+    putChar(output, '"');
+    putBytes(output, fieldNames[TEXT_FIELDS], strlen(fieldNames[TEXT_FIELDS]));
+    putBytes(output, "\": ", 3);
+    putNumber(output, book->numPages);
+    putBytes(output, "}\n", 2);
+}
+
+static void writeBinary(Output* output, const BookView* book) {
+    const char* fields[TEXT_FIELDS];
+    viewFields(book, fields);
+
+    for (int i = 0; i < TEXT_FIELDS; i++) {
+        if (fields[i] == NULL) {
+            putUint32(output, 0);
+            continue;
+        }
+        size_t length = strlen(fields[i]);
+        putUint32(output, (uint32_t) length + 1);
+        putBytes(output, fields[i], length);
+    }
+    putUint32(output, (uint32_t) book->numPages);
+}
+
+static void viewFields(const BookView* book, const char* fields[TEXT_FIELDS]) {
+    fields[0] = book->title;
+    fields[1] = book->author;
+    fields[2] = book->publisher;
+    fields[3] = book->publicationDate;
+    fields[4] = book->ISBN;
+    fields[5] = book->genre;
+    fields[6] = book->lang;
+}
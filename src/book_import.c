@@ -0,0 +1,837 @@
+/**
+ * File: book_import.c
+ * 
+ * Project: CLManager
+ * 
+ * Author: Issiah J Banda
+ * 
+ * Date Of Creation: 2026-10-17 //YYYY-MM-DD
+ * 
+ * Description: Imports books from CSV, JSONL and binary export files. The file is streamed through
+ *              a fixed size buffer into a small parser state machine, and parsed rows
+ *              are inserted in batches so large catalogs load quickly.
+ * 
+ * Modification History:
+ *      - 2026-10-17: Created the streaming CSV and JSONL importer.
+ *      - 2026-10-17: Added reading the binary format written by exportBooks.
+ *      - 2026-10-17: JSON \u escapes need four hex digits, and unpaired surrogates become U+FFFD.
+ *      - 2026-10-17: Rejected binary files that declare a field longer than MAX_BINARY_FIELD_SIZE.
+ *      - 2026-10-17: Parsed page counts from a terminated copy and rejected trailing characters.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "book_import.h"
+#include "book_export.h"
+
+/* Bytes read from the file at a time.*/
+#define READ_CHUNK_SIZE (64 * 1024)
+/* The longest field a binary import file may declare, a longer one rejects the file.*/
+#define MAX_BINARY_FIELD_SIZE (1024 * 1024)
+/* Rows parsed before they are inserted as one batch.*/
+#define IMPORT_BATCH_SIZE 5000
+/* The most CSV columns looked at, later columns are ignored.*/
+#define MAX_COLUMNS 64
+
+/* The BookData fields a column can map to, and the number of them.*/
+enum {
+    FIELD_TITLE,
+    FIELD_AUTHOR,
+    FIELD_PUBLISHER,
+    FIELD_PUBLICATION_DATE,
+    FIELD_ISBN,
+    FIELD_GENRE,
+    FIELD_LANG,
+    FIELD_NUM_PAGES,
+    FIELD_COUNT
+};
+
+/* Marks a text field of an ImportRow that has no value.*/
+#define NO_VALUE ((size_t) -1)
+
+/* A parsed row waiting to be inserted. Text fields are offsets into the
+    string pool of the importer, since the pool moves when it grows.*/
+typedef struct {
+    size_t text[FIELD_NUM_PAGES];
+    int numPages;
+} ImportRow;
+
+/* States of the CSV parser.*/
+typedef enum {
+    CSV_FIELD_START,
+    CSV_UNQUOTED,
+    CSV_QUOTED,
+    /* Saw a quote inside a quoted field, it is either doubled or ends the field*/
+    CSV_QUOTE_IN_QUOTED
+} CsvState;
+
+typedef struct {
+    LibraryDb* library;
+    ImportFormat format;
+    ImportReport* report;
+    /* Set when inserting a batch failed, stops the import*/
+    int failed;
+
+    /* The record being parsed. A CSV record keeps each field null-terminated
+        in this buffer, a JSONL record keeps the whole line.*/
+    char* record;
+    size_t recordLength;
+    size_t recordCapacity;
+    size_t columnStarts[MAX_COLUMNS];
+    int columnCount;
+    CsvState csvState;
+    /* For CSV, the field each column maps to or -1. Filled from the header.*/
+    int columnFields[MAX_COLUMNS];
+    int sawHeader;
+    /* For binary files, bytes of the record buffer already parsed*/
+    size_t binaryParsed;
+
+    /* The batch of parsed rows and the pool holding their strings*/
+    ImportRow rows[IMPORT_BATCH_SIZE];
+    int rowCount;
+    /* The batch as handed to libraryAddBooks, and the result of each insert*/
+    BookData books[IMPORT_BATCH_SIZE];
+    InsertStatus statuses[IMPORT_BATCH_SIZE];
+    char* pool;
+    size_t poolLength;
+    size_t poolCapacity;
+} Importer;
+
+/**
+ * Feeds a chunk of CSV text to the CSV parser.
+*/
+static void parseCsv(Importer* importer, const char* data, size_t length);
+/**
+ * Feeds a chunk of JSONL text to the JSONL parser.
+*/
+static void parseJsonLines(Importer* importer, const char* data, size_t length);
+/**
+ * Feeds a chunk of a binary export to the binary parser.
+*/
+static void parseBinary(Importer* importer, const char* data, size_t length);
+/**
+ * Parses one binary record starting at the given offset of the record buffer.
+ * @returns The size of the record, or 0 if the buffer does not hold all of it yet.
+*/
+static size_t parseBinaryRecord(Importer* importer, size_t offset);
+/**
+ * Reads a 4 byte little endian integer.
+*/
+static uint32_t readUint32(const char* bytes);
+/**
+ * Ends the current CSV field, null-terminating it in the record buffer.
+*/
+static void endCsvField(Importer* importer);
+/**
+ * Ends the current CSV record. The first record is read as the header, the
+ * rest become rows.
+*/
+static void endCsvRecord(Importer* importer);
+/**
+ * Parses the JSON object held in the record buffer into a row.
+ * @returns 1 if the object was parsed, else returns 0.
+*/
+static int parseJsonObject(Importer* importer);
+/**
+ * Decodes a JSON string in place. pos points just after the opening quote.
+ * @returns The length of the decoded string, or -1 if it is malformed. pos is
+ *          left just after the closing quote.
+*/
+static long decodeJsonString(char* text, size_t* pos);
+/**
+ * Reads the 4 hex digits of a \u escape. Stops at the first character that
+ * is not a hex digit, so it never reads past the end of the text.
+ * @param code Receives the value of the digits.
+ * @returns 1 if there were 4 hex digits, else returns 0.
+*/
+static int readHex4(const char* text, size_t pos, unsigned long* code);
+/**
+ * Appends a byte to the record buffer, growing it when full.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int appendRecord(Importer* importer, char c);
+/**
+ * Finds the field a column or key name maps to.
+ * @returns The field, or -1 if the name is not a field.
+*/
+static int fieldForName(const char* name);
+/**
+ * Starts a new row in the batch with every field empty.
+ * @returns The row, or NULL if the import has failed.
+*/
+static ImportRow* beginRow(Importer* importer);
+/**
+ * Sets a field of a row. Text is copied into the string pool, an empty value
+ * leaves the field empty.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int setRowField(Importer* importer, ImportRow* row, int field, const char* value, size_t length);
+/**
+ * Inserts the batch of rows into the library and counts the results.
+*/
+static void flushRows(Importer* importer);
+/**
+ * Gets the most memory the process has used, in KiB.
+ * @returns The peak memory, or -1 if it is not known on this platform.
+*/
+static long peakMemoryKb(void);
+
+int importBooks(LibraryDb* library, const char* path, ImportFormat format, ImportReport* report) {
+    ImportReport localReport;
+    if (report == NULL) {
+        report = &localReport;
+    }
+    memset(report, 0, sizeof(ImportReport));
+    if (library == NULL || path == NULL) {
+        return OPERATION_FAIL;
+    }
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Cannot open import file: %s\n", path);
+        return OPERATION_FAIL;
+    }
+
+    // The importer is large because of the row batch, keep it off the stack
+    Importer* importer = calloc(1, sizeof(Importer));
+    char* chunk = malloc(READ_CHUNK_SIZE);
+    if (importer == NULL || chunk == NULL) {
+        fprintf(stderr, "Error Allocating Memory in importBooks\n");
+        free(importer);
+        free(chunk);
+        fclose(file);
+        return OPERATION_FAIL;
+    }
+    importer->library = library;
+    importer->format = format;
+    importer->report = report;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    size_t length;
+    while (!importer->failed && (length = fread(chunk, 1, READ_CHUNK_SIZE, file)) > 0) {
+        if (format == IMPORT_JSONL) {
+            parseJsonLines(importer, chunk, length);
+        } else if (format == IMPORT_BINARY) {
+            parseBinary(importer, chunk, length);
+        } else {
+            parseCsv(importer, chunk, length);
+        }
+    }
+
+    // A last record without a trailing line break
+    if (!importer->failed) {
+        if (format == IMPORT_JSONL) {
+            parseJsonLines(importer, "\n", 1);
+        } else if (format == IMPORT_BINARY) {
+            if (importer->recordLength > 0) {
+                importer->report->malformed++; // A record cut short
+            }
+        } else if (importer->csvState != CSV_FIELD_START || importer->columnCount > 0) {
+            parseCsv(importer, "\n", 1);
+        }
+        flushRows(importer);
+    }
+
+    int result = ferror(file) || importer->failed ? OPERATION_FAIL : OPERATION_SUCCESS;
+    if (format != IMPORT_JSONL && !importer->sawHeader && !importer->failed) {
+        fprintf(stderr, "Import file has no header: %s\n", path);
+        result = OPERATION_FAIL;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    report->seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    report->peakMemoryKb = peakMemoryKb();
+
+    free(importer->record);
+    free(importer->pool);
+    free(importer);
+    free(chunk);
+    fclose(file);
+    return result;
+}
+
+ImportFormat importFormatForPath(const char* path) {
+    const char* extension = path != NULL ? strrchr(path, '.') : NULL;
+    if (extension != NULL && (strcasecmp(extension, ".jsonl") == 0 ||
+                              strcasecmp(extension, ".ndjson") == 0 ||
+                              strcasecmp(extension, ".json") == 0)) {
+        return IMPORT_JSONL;
+    }
+    if (extension != NULL && (strcasecmp(extension, ".clmb") == 0 || strcasecmp(extension, ".bin") == 0)) {
+        return IMPORT_BINARY;
+    }
+    return IMPORT_CSV;
+}
+
+static void parseCsv(Importer* importer, const char* data, size_t length) {
+    for (size_t i = 0; i < length && !importer->failed; i++) {
+        char c = data[i];
+
+        switch (importer->csvState) {
+            case CSV_QUOTED:
+                if (c == '"') {
+                    importer->csvState = CSV_QUOTE_IN_QUOTED;
+                } else {
+                    appendRecord(importer, c);
+                }
+                continue;
+            case CSV_QUOTE_IN_QUOTED:
+                if (c == '"') {
+                    // A doubled quote is a literal quote
+                    appendRecord(importer, c);
+                    importer->csvState = CSV_QUOTED;
+                    continue;
+                }
+                importer->csvState = CSV_UNQUOTED;
+                break; // The quoted part is over, handle c as unquoted text
+            case CSV_FIELD_START:
+                if (c == '"') {
+                    importer->csvState = CSV_QUOTED;
+                    continue;
+                }
+                importer->csvState = CSV_UNQUOTED;
+                break;
+            case CSV_UNQUOTED:
+                break;
+        }
+
+        if (c == ',') {
+            endCsvField(importer);
+            importer->csvState = CSV_FIELD_START;
+        } else if (c == '\n') {
+            endCsvField(importer);
+            endCsvRecord(importer);
+            importer->csvState = CSV_FIELD_START;
+        } else if (c != '\r') {
+            appendRecord(importer, c);
+        }
+    }
+}
+
+static void parseBinary(Importer* importer, const char* data, size_t length) {
+    // Records can span chunks, so the unparsed tail is kept in the record buffer
+    if (importer->recordLength + length > importer->recordCapacity) {
+        size_t capacity = importer->recordLength + length;
+        char* grown = realloc(importer->record, capacity);
+        if (grown == NULL) {
+            fprintf(stderr, "Error Allocating Memory in importBooks\n");
+            importer->failed = 1;
+            return;
+        }
+        importer->record = grown;
+        importer->recordCapacity = capacity;
+    }
+    memcpy(importer->record + importer->recordLength, data, length);
+    importer->recordLength += length;
+
+    size_t offset = 0;
+    if (!importer->sawHeader) {
+        if (importer->recordLength < BOOK_BINARY_MAGIC_SIZE) {
+            return;
+        }
+        if (memcmp(importer->record, BOOK_BINARY_MAGIC, BOOK_BINARY_MAGIC_SIZE) != 0) {
+            fprintf(stderr, "Import file is not a binary book export\n");
+            importer->failed = 1;
+            return;
+        }
+        importer->sawHeader = 1;
+        offset = BOOK_BINARY_MAGIC_SIZE;
+    }
+
+    size_t size;
+    while (!importer->failed && (size = parseBinaryRecord(importer, offset)) > 0) {
+        offset += size;
+    }
+
+    importer->recordLength -= offset;
+    memmove(importer->record, importer->record + offset, importer->recordLength);
+}
+
+static size_t parseBinaryRecord(Importer* importer, size_t offset) {
+    const char* record = importer->record + offset;
+    size_t available = importer->recordLength - offset;
+
+    // Check the whole record is buffered before adding a row for it
+    size_t size = 0;
+    for (int field = 0; field < FIELD_NUM_PAGES; field++) {
+        if (available - size < 4) {
+            return 0;
+        }
+        uint32_t length = readUint32(record + size);
+        size += 4;
+        if (length > 0) {
+            // The record buffer grows to hold a whole record, so a corrupt length must not size it
+            if (length - 1 > MAX_BINARY_FIELD_SIZE) {
+                fprintf(stderr, "Import file has a field of %lu bytes, the most is %d\n",
+                        (unsigned long) (length - 1), MAX_BINARY_FIELD_SIZE);
+                importer->failed = 1;
+                return 0;
+            }
+            if (available - size < length - 1) {
+                return 0;
+            }
+            size += length - 1;
+        }
+    }
+    if (available - size < 4) {
+        return 0;
+    }
+
+    importer->report->rowsRead++;
+    ImportRow* row = beginRow(importer);
+    if (row == NULL) {
+        return 0;
+    }
+    size_t pos = 0;
+    for (int field = 0; field < FIELD_NUM_PAGES; field++) {
+        uint32_t length = readUint32(record + pos);
+        pos += 4;
+        if (length > 0) {
+            if (!setRowField(importer, row, field, record + pos, length - 1)) {
+                return 0;
+            }
+            pos += length - 1;
+        }
+    }
+    row->numPages = (int) readUint32(record + pos);
+    return size + 4;
+}
+
+static uint32_t readUint32(const char* bytes) {
+    const unsigned char* b = (const unsigned char*) bytes;
+    return (uint32_t) b[0] | ((uint32_t) b[1] << 8) | ((uint32_t) b[2] << 16) | ((uint32_t) b[3] << 24);
+}
+
+static void endCsvField(Importer* importer) {
+    appendRecord(importer, '\0');
+    if (importer->columnCount < MAX_COLUMNS) {
+        importer->columnCount++;
+    }
+    // The next field starts after this one's terminator
+    if (importer->columnCount < MAX_COLUMNS) {
+        importer->columnStarts[importer->columnCount] = importer->recordLength;
+    }
+}
+
+static void endCsvRecord(Importer* importer) {
+    int columns = importer->columnCount;
+    importer->columnCount = 0;
+    importer->recordLength = 0;
+    importer->columnStarts[0] = 0;
+
+    // Blank lines are skipped
+    if (columns == 1 && importer->record[0] == '\0') {
+        return;
+    }
+
+    if (!importer->sawHeader) {
+        importer->sawHeader = 1;
+        int known = 0;
+        for (int i = 0; i < columns; i++) {
+            importer->columnFields[i] = fieldForName(importer->record + importer->columnStarts[i]);
+            known += importer->columnFields[i] >= 0;
+        }
+        for (int i = columns; i < MAX_COLUMNS; i++) {
+            importer->columnFields[i] = -1;
+        }
+        if (known == 0) {
+            fprintf(stderr, "Import header has no known columns\n");
+            importer->failed = 1;
+        }
+        return;
+    }
+
+    importer->report->rowsRead++;
+    ImportRow* row = beginRow(importer);
+    if (row == NULL) {
+        return;
+    }
+    for (int i = 0; i < columns; i++) {
+        if (importer->columnFields[i] < 0) {
+            continue;
+        }
+        const char* value = importer->record + importer->columnStarts[i];
+        if (!setRowField(importer, row, importer->columnFields[i], value, strlen(value))) {
+            importer->rowCount--; // Drop the half filled row
+            importer->report->malformed++;
+            return;
+        }
+    }
+}
+
+static void parseJsonLines(Importer* importer, const char* data, size_t length) {
+    for (size_t i = 0; i < length && !importer->failed; i++) {
+        char c = data[i];
+        if (c != '\n') {
+            appendRecord(importer, c);
+            continue;
+        }
+
+        // Skip blank lines, including a lone \r
+        size_t start = 0;
+        while (start < importer->recordLength &&
+               (importer->record[start] == ' ' || importer->record[start] == '\t' ||
+                importer->record[start] == '\r')) {
+            start++;
+        }
+        if (start < importer->recordLength) {
+            appendRecord(importer, '\0');
+            importer->report->rowsRead++;
+            if (!parseJsonObject(importer)) {
+                importer->report->malformed++;
+            }
+        }
+        importer->recordLength = 0;
+    }
+}
+
+static int parseJsonObject(Importer* importer) {
+    char* text = importer->record;
+    size_t pos = 0;
+
+#define SKIP_SPACE() while (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r') pos++
+
+    SKIP_SPACE();
+    if (text[pos++] != '{') {
+        return 0;
+    }
+
+    ImportRow* row = beginRow(importer);
+    if (row == NULL) {
+        return 1; // The import failed, the row is not malformed
+    }
+
+    SKIP_SPACE();
+    if (text[pos] == '}') {
+        pos++;
+    } else {
+        while (1) {
+            SKIP_SPACE();
+            if (text[pos++] != '"') {
+                break;
+            }
+            char* key = text + pos;
+            long keyLength = decodeJsonString(text, &pos);
+            if (keyLength < 0) {
+                break;
+            }
+            key[keyLength] = '\0';
+            int field = fieldForName(key);
+
+            SKIP_SPACE();
+            if (text[pos++] != ':') {
+                break;
+            }
+            SKIP_SPACE();
+
+            int ok = 1;
+            if (text[pos] == '"') {
+                pos++;
+                char* value = text + pos;
+                long valueLength = decodeJsonString(text, &pos);
+                ok = valueLength >= 0 &&
+                     (field < 0 || setRowField(importer, row, field, value, valueLength));
+            } else if (strncmp(text + pos, "null", 4) == 0) {
+                pos += 4;
+            } else if (text[pos] == '-' || (text[pos] >= '0' && text[pos] <= '9')) {
+                char* numberEnd;
+                double number = strtod(text + pos, &numberEnd);
+                size_t numberLength = numberEnd - (text + pos);
+                if (field == FIELD_NUM_PAGES) {
+                    row->numPages = (int) number;
+                } else if (field >= 0) {
+                    ok = setRowField(importer, row, field, text + pos, numberLength);
+                }
+                pos += numberLength;
+            } else if (strncmp(text + pos, "true", 4) == 0 || strncmp(text + pos, "false", 5) == 0) {
+                pos += text[pos] == 't' ? 4 : 5;
+            } else {
+                ok = 0; // Nested objects and arrays are not book fields
+            }
+            if (!ok) {
+                break;
+            }
+
+            SKIP_SPACE();
+            if (text[pos] == ',') {
+                pos++;
+                continue;
+            }
+            if (text[pos] == '}') {
+                pos++;
+                SKIP_SPACE();
+                if (text[pos] == '\0') {
+                    return 1;
+                }
+            }
+            break;
+        }
+
+        importer->rowCount--; // Drop the half filled row
+        return 0;
+    }
+
+    SKIP_SPACE();
+    if (text[pos] != '\0') {
+        importer->rowCount--;
+        return 0;
+    }
+    return 1;
+
+#undef SKIP_SPACE
+}
+
+static long decodeJsonString(char* text, size_t* pos) {
+    size_t read = *pos;
+    size_t write = *pos;
+
+    while (text[read] != '"') {
+        char c = text[read++];
+        if (c == '\0') {
+            return -1;
+        }
+        if (c != '\\') {
+            text[write++] = c;
+            continue;
+        }
+
+        c = text[read++];
+        switch (c) {
+            case '"': case '\\': case '/': text[write++] = c; break;
+            case 'b': text[write++] = '\b'; break;
+            case 'f': text[write++] = '\f'; break;
+            case 'n': text[write++] = '\n'; break;
+            case 'r': text[write++] = '\r'; break;
+            case 't': text[write++] = '\t'; break;
+            case 'u': {
+                unsigned long code;
+                if (!readHex4(text, read, &code)) {
+                    return -1;
+                }
+                read += 4;
+                if (code >= 0xD800 && code <= 0xDFFF) {
+                    // Join a surrogate pair into one code point, a lone surrogate
+                    // is not valid UTF-8 so it becomes U+FFFD
+                    unsigned long low;
+                    if (code <= 0xDBFF && text[read] == '\\' && text[read + 1] == 'u' &&
+                        readHex4(text, read + 2, &low) && low >= 0xDC00 && low <= 0xDFFF) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        read += 6;
+                    } else {
+                        code = 0xFFFD;
+                    }
+                }
+
+                // Encode as UTF-8, never longer than the escape it replaces
+                if (code < 0x80) {
+                    text[write++] = (char) code;
+                } else if (code < 0x800) {
+                    text[write++] = (char) (0xC0 | (code >> 6));
+                    text[write++] = (char) (0x80 | (code & 0x3F));
+                } else if (code < 0x10000) {
+                    text[write++] = (char) (0xE0 | (code >> 12));
+                    text[write++] = (char) (0x80 | ((code >> 6) & 0x3F));
+                    text[write++] = (char) (0x80 | (code & 0x3F));
+                } else {
+                    text[write++] = (char) (0xF0 | (code >> 18));
+                    text[write++] = (char) (0x80 | ((code >> 12) & 0x3F));
+                    text[write++] = (char) (0x80 | ((code >> 6) & 0x3F));
+                    text[write++] = (char) (0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default:
+                return -1;
+        }
+    }
+
+    long length = (long) (write - *pos);
+    *pos = read + 1; // Past the closing quote
+    return length;
+}
+
+static int readHex4(const char* text, size_t pos, unsigned long* code) {
+    *code = 0;
+    for (int i = 0; i < 4; i++) {
+        char h = text[pos + i];
+        *code <<= 4;
+        if (h >= '0' && h <= '9') *code |= h - '0';
+        else if (h >= 'a' && h <= 'f') *code |= h - 'a' + 10;
+        else if (h >= 'A' && h <= 'F') *code |= h - 'A' + 10;
+        else return 0; // Also stops at the terminating NUL
+    }
+    return 1;
+}
+
+static int appendRecord(Importer* importer, char c) {
+    if (importer->recordLength == importer->recordCapacity) {
+        size_t capacity = importer->recordCapacity > 0 ? importer->recordCapacity * 2 : 1024;
+        char* grown = realloc(importer->record, capacity);
+        if (grown == NULL) {
+            fprintf(stderr, "Error Allocating Memory in importBooks\n");
+            importer->failed = 1;
+            return 0;
+        }
+        importer->record = grown;
+        importer->recordCapacity = capacity;
+    }
+    importer->record[importer->recordLength++] = c;
+    return 1;
+}
+
+static int fieldForName(const char* name) {
+    static const struct {
+        const char* name;
+        int field;
+    } names[] = {
+        {"Title", FIELD_TITLE},
+        {"Author", FIELD_AUTHOR},
+        {"Publisher", FIELD_PUBLISHER},
+        {"PublicationDate", FIELD_PUBLICATION_DATE},
+        {"ISBN", FIELD_ISBN},
+        {"Genre", FIELD_GENRE},
+        {"Language", FIELD_LANG},
+        {"Lang", FIELD_LANG},
+        {"NumberOfPages", FIELD_NUM_PAGES},
+        {"NumPages", FIELD_NUM_PAGES},
+        {"Pages", FIELD_NUM_PAGES}
+    };
+
+    // Allow spaces around CSV header names
+    while (*name == ' ') {
+        name++;
+    }
+    size_t length = strlen(name);
+    while (length > 0 && name[length - 1] == ' ') {
+        length--;
+    }
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strlen(names[i].name) == length && strncasecmp(name, names[i].name, length) == 0) {
+            return names[i].field;
+        }
+    }
+    return -1;
+}
+
+static ImportRow* beginRow(Importer* importer) {
+    if (importer->rowCount == IMPORT_BATCH_SIZE) {
+        flushRows(importer);
+    }
+    if (importer->failed) {
+        return NULL;
+    }
+
+    ImportRow* row = &importer->rows[importer->rowCount++];
+    for (int i = 0; i < FIELD_NUM_PAGES; i++) {
+        row->text[i] = NO_VALUE;
+    }
+    row->numPages = 0;
+    return row;
+}
+
+static int setRowField(Importer* importer, ImportRow* row, int field, const char* value, size_t length) {
+    if (field == FIELD_NUM_PAGES) {
+        // A JSONL value is not terminated at length, so only a copy of it is parsed
+        char number[24];
+        if (length >= sizeof(number)) {
+            return 0; // Too long to be a page count
+        }
+        memcpy(number, value, length);
+        number[length] = '\0';
+        char* end;
+        long pages = strtol(number, &end, 10);
+        if (*end != '\0' || (end == number && length > 0)) {
+            return 0; // Not a number
+        }
+        row->numPages = (int) pages;
+        return 1;
+    }
+    if (length == 0) {
+        row->text[field] = NO_VALUE;
+        return 1;
+    }
+
+    if (importer->poolLength + length + 1 > importer->poolCapacity) {
+        size_t capacity = importer->poolCapacity > 0 ? importer->poolCapacity * 2 : READ_CHUNK_SIZE;
+        while (capacity < importer->poolLength + length + 1) {
+            capacity *= 2;
+        }
+        char* grown = realloc(importer->pool, capacity);
+        if (grown == NULL) {
+            fprintf(stderr, "Error Allocating Memory in importBooks\n");
+            importer->failed = 1;
+            return 0;
+        }
+        importer->pool = grown;
+        importer->poolCapacity = capacity;
+    }
+
+    row->text[field] = importer->poolLength;
+    memcpy(importer->pool + importer->poolLength, value, length);
+    importer->poolLength += length;
+    importer->pool[importer->poolLength++] = '\0';
+    return 1;
+}
+
+static void flushRows(Importer* importer) {
+    if (importer->rowCount == 0) {
+        return;
+    }
+
+    BookData* books = importer->books;
+    InsertStatus* statuses = importer->statuses;
+    for (int i = 0; i < importer->rowCount; i++) {
+        char* text[FIELD_NUM_PAGES];
+        for (int field = 0; field < FIELD_NUM_PAGES; field++) {
+            size_t offset = importer->rows[i].text[field];
+            text[field] = offset == NO_VALUE ? NULL : importer->pool + offset;
+        }
+        books[i].title = text[FIELD_TITLE];
+        books[i].author = text[FIELD_AUTHOR];
+        books[i].publisher = text[FIELD_PUBLISHER];
+        books[i].publicationDate = text[FIELD_PUBLICATION_DATE];
+        books[i].ISBN = text[FIELD_ISBN];
+        books[i].genre = text[FIELD_GENRE];
+        books[i].lang = text[FIELD_LANG];
+        books[i].numPages = importer->rows[i].numPages;
+        books[i].id = 0;
+    }
+
+    long inserted = libraryAddBooks(importer->library, books, importer->rowCount, statuses);
+    if (inserted < 0) {
+        importer->failed = 1;
+    }
+    for (int i = 0; i < importer->rowCount; i++) {
+        switch (statuses[i]) {
+            case INSERT_OK: importer->report->inserted++; break;
+            case INSERT_DUPLICATE: importer->report->duplicates++; break;
+            case INSERT_INVALID: importer->report->invalid++; break;
+            case INSERT_ERROR: break;
+        }
+    }
+
+    importer->rowCount = 0;
+    importer->poolLength = 0;
+}
+
+static long peakMemoryKb(void) {
+#ifdef _WIN32
+    return -1;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+    return usage.ru_maxrss; // Already KiB on Linux
+#endif
+}
@@ -19,232 +19,3469 @@
  *      - 2023-10-09: Finished the deleteBookById function and worked on getBooks function.
  *      - 2023-10-11: Finished the getBooks function along with creating BookArray struct.
  *                      Removed extra print statements, and added comments to functions.
+ *      - 2026-10-17: Added a prepared statement cache so addBook, deleteBookById and
+ *                      getBooks no longer re-parse their SQL on every call.
+ *      - 2026-10-17: Added addBooks for inserting many books inside chunked transactions.
+ *      - 2026-10-17: Added the BookCursor streaming API (openBooks, nextBook, closeBooks).
+ *      - 2026-10-17: Added getBooksArena, which allocates all rows and fields from a few
+ *                      large chunks, and freeBookArray for freeing either kind of BookArray.
+ *      - 2026-10-17: BookArray now grows geometrically and tracks its capacity. Added
+ *                      reloadBooks for refilling an existing BookArray.
+ *      - 2026-10-17: Added keyset pagination with getBooksPage and getBooksPageBefore.
+ *                      BookData now carries the BookID of the book.
+ *      - 2026-10-17: Added the BooksSearch FTS5 index kept in sync by triggers, and
+ *                      searchLocalBooks for ranked local search.
+ *      - 2026-10-17: Added indexes on Author, Genre and Language, getBooksWhere, and a
+ *                      cache of statements built per query shape.
+ *      - 2026-10-17: Added ConnectionProfile tuning presets and makeConnectionEx.
+ *      - 2026-10-17: Moved the connection and its statement caches into the LibraryDb
+ *                      handle. Added the library functions that take a handle, the
+ *                      original functions now use the default handle.
+ *      - 2026-10-17: addBook can now hand back the id of the new book. Added transaction
+ *                      functions and a busy timeout for handles sharing a file.
+ *      - 2026-10-17: Added nextBookView, which reads a row without copying it.
+ *      - 2026-10-17: Added forEachBook, which visits the books matching a filter
+ *                      without allocating.
+ *      - 2026-10-17: Filtered queries can read only the fields in a BOOK_FIELD_* mask.
+ *      - 2026-10-17: Added the optional in memory ISBN index and hasIsbn.
+ *      - 2026-10-17: Added upsertBook, an insert or update keyed on ISBN.
+ *      - 2026-10-17: Added updateBook, which writes only the columns in a field mask.
+ *      - 2026-10-17: Added deleteBooksByIds and deleteBooksWhere for bulk deletes.
+ *      - 2026-10-17: Added getLibraryStats and countBooksBy. The Author, Genre and
+ *                      Language indexes now hold NumberOfPages so both run from them.
+ *      - 2026-10-17: Added the LibraryStats table, kept up to date by triggers, which
+ *                      getLibraryStats now reads. Added rebuildStats.
+ *      - 2026-10-17: Added getBookColumns, a snapshot of the books stored by column.
+ *      - 2026-10-17: Arena backed BookArrays now intern the author, publisher, genre and
+ *                      language fields. Added getBookArrayInternStats.
+ *      - 2026-10-17: New libraries keep authors, publishers, genres and languages in name
+ *                      tables referenced by BookRecords, behind a Books view. Added
+ *                      migrateSchema and renameFieldValue.
+ *      - 2026-10-17: The ISBN index is reloaded when PRAGMA data_version shows another
+ *                      connection committed.
+ *      - 2026-10-17: Handles opened before migrateSchema switch to the new schema, and
+ *                      names left without books are pruned once per statement.
+ *      - 2026-10-17: countBooksBy reads its counts from the LibraryStats table.
+ *      - 2026-10-17: The schema is set up once and its version kept in PRAGMA user_version.
+ *      - 2026-10-17: Pages presize at most PAGE_PRESIZE books, larger limits grow as rows arrive.
+ *      - 2026-10-17: Renamed UPSERT_OVERWRITE to UPSERT_MERGE, as it keeps stored values for NULL fields.
 */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "sqlite3.h"
 #include "dbmanager.h"
+#include "isbn_set.h"
 
-static sqlite3* db;
+/* Identifies each statement kept inside the statement cache.*/
+typedef enum {
+    STMT_INSERT_BOOK,
+    STMT_DELETE_BOOK,
+    STMT_SELECT_BOOKS,
+    STMT_COUNT_BOOKS,
+    STMT_SELECT_PAGE_AFTER,
+    STMT_SELECT_PAGE_BEFORE,
+    STMT_SEARCH_BOOKS,
+    STMT_SELECT_ISBNS,
+    STMT_FIND_ISBN,
+    STMT_UPSERT_MERGE,
+    STMT_UPSERT_FILL_MISSING,
+    STMT_UPSERT_KEEP_EXISTING,
+    STMT_SELECT_ISBN_BY_ID,
+    STMT_INSERT_DELETE_ID,
+    STMT_DELETE_LISTED,
+    STMT_CLEAR_DELETE_IDS,
+    STMT_LIBRARY_STATS,
+    STMT_COUNT_BY,
+    STMT_STORE_AUTHOR,
+    STMT_STORE_PUBLISHER,
+    STMT_STORE_GENRE,
+    STMT_STORE_LANGUAGE,
+    STMT_PRUNE_AUTHOR,
+    STMT_PRUNE_PUBLISHER,
+    STMT_PRUNE_GENRE,
+    STMT_PRUNE_LANGUAGE,
+    STMT_NAME_IDS_BY_ID,
+    STMT_NAME_IDS_BY_ISBN,
+    STMT_NAME_IDS_BY_NAMES,
+    STMT_SAVEPOINT,
+    STMT_ROLLBACK_SAVEPOINT,
+    STMT_RELEASE_SAVEPOINT,
+    STMT_DATA_VERSION,
+    STMT_CACHE_SIZE
+} StatementId;
+
+/* The insert of a new book, bound by bindBook.*/
+#define INSERT_BOOK_SQL \
+    "INSERT INTO Books (Title, Author, Publisher, PublicationDate, ISBN, Genre, Language, NumberOfPages) " \
+    "VALUES (?, ?, ?, ?, ?, ?, ?, ?)"
+
+/* The id a name has in the name table of a field, e.g. NAME_ID(Author, "?")
+    looks the name up in Authors. NULL if the name is NULL or not stored.*/
+#define NAME_ID(field, name) "(SELECT " #field "ID FROM " #field "s WHERE Name = " name ")"
+/* The name a BookRecords row, held in row, has for a field.*/
+#define NAME_OF(field, row) "(SELECT Name FROM " #field "s WHERE " #field "ID = " row "." #field "ID)"
+/* The value a Books row, held in row, has for a field.*/
+#define BOOK_VALUE(field, row) row "." #field
+/* Adds the name a Books row, held in row, has for a field to the name table
+    of the field. OR IGNORE skips names that are stored already and NULLs.*/
+#define STORE_NAME(field, row) "INSERT OR IGNORE INTO " #field "s (Name) VALUES (" row "." #field "); "
+#define STORE_NAMES(row) \
+    STORE_NAME(Author, row) STORE_NAME(Publisher, row) STORE_NAME(Genre, row) STORE_NAME(Language, row)
+/* Removes the names with the ids in the JSON array ?1 from the name table of
+    a field, except the ones a book still has.*/
+#define PRUNE_NAME_SQL(field) \
+    "DELETE FROM " #field "s WHERE " #field "ID IN (SELECT value FROM json_each(?1)) " \
+    "AND NOT EXISTS (SELECT 1 FROM BookRecords WHERE " #field "ID = " #field "s." #field "ID)"
+/* The name ids of a BookRecords row, in the order pruneNames takes them.*/
+#define RECORD_NAME_IDS "AuthorID, PublisherID, GenreID, LanguageID"
+/* The BookRecords row of a Books row, held in row, in column order.*/
+#define RECORD_VALUES(row) \
+    row ".BookID, " row ".Title, " NAME_ID(Author, row ".Author") ", " NAME_ID(Publisher, row ".Publisher") ", " \
+    row ".PublicationDate, " row ".ISBN, " NAME_ID(Genre, row ".Genre") ", " NAME_ID(Language, row ".Language") ", " \
+    row ".NumberOfPages"
+
+/* INSERT_BOOK_SQL for a normalized library, bound by bindBook. The names
+    must have been stored by storeNames first.*/
+#define INSERT_RECORD_SQL \
+    "INSERT INTO BookRecords (Title, AuthorID, PublisherID, PublicationDate, ISBN, GenreID, LanguageID, NumberOfPages) " \
+    "VALUES (?, " NAME_ID(Author, "?") ", " NAME_ID(Publisher, "?") ", ?, ?, " NAME_ID(Genre, "?") ", " \
+    NAME_ID(Language, "?") ", ?)"
+
+/* The value a column has in the stored book with the ISBN ?5 of an upsert.*/
+#define STORED_VALUE(column, table) "(SELECT " column " FROM " table " WHERE ISBN = ?5)"
+
+/* The insert every upsert statement starts with, bound by bindBook. A NULL
+    Title or Author is taken from the stored book, as the NOT NULL check runs
+    before ON CONFLICT does.*/
+#define UPSERT_BOOK_SQL \
+    "INSERT INTO Books (Title, Author, Publisher, PublicationDate, ISBN, Genre, Language, NumberOfPages) " \
+    "VALUES (COALESCE(?1, " STORED_VALUE("Title", "Books") "), COALESCE(?2, " STORED_VALUE("Author", "Books") "), " \
+    "?3, ?4, ?5, ?6, ?7, ?8)"
+
+/* UPSERT_BOOK_SQL for a normalized library. The names must have been
+    stored by storeNames first.*/
+#define UPSERT_RECORD_SQL \
+    "INSERT INTO BookRecords (Title, AuthorID, PublisherID, PublicationDate, ISBN, GenreID, LanguageID, NumberOfPages) " \
+    "VALUES (COALESCE(?1, " STORED_VALUE("Title", "BookRecords") "), " \
+    "COALESCE(" NAME_ID(Author, "?2") ", " STORED_VALUE("AuthorID", "BookRecords") "), " \
+    NAME_ID(Publisher, "?3") ", ?4, ?5, " NAME_ID(Genre, "?6") ", " NAME_ID(Language, "?7") ", ?8)"
+
+/* The upserts of UPSERT_MERGE and UPSERT_FILL_MISSING, given the insert
+    they start with and the columns that hold the names.*/
+#define UPSERT_MERGE_SQL(insert, author, publisher, genre, language) \
+    insert " ON CONFLICT(ISBN) DO UPDATE SET " \
+    "Title = COALESCE(excluded.Title, Title), " \
+    author " = COALESCE(excluded." author ", " author "), " \
+    publisher " = COALESCE(excluded." publisher ", " publisher "), " \
+    "PublicationDate = COALESCE(excluded.PublicationDate, PublicationDate), " \
+    genre " = COALESCE(excluded." genre ", " genre "), " \
+    language " = COALESCE(excluded." language ", " language "), " \
+    "NumberOfPages = COALESCE(NULLIF(excluded.NumberOfPages, 0), NumberOfPages)"
+#define UPSERT_FILL_MISSING_SQL(insert, publisher, genre, language) \
+    insert " ON CONFLICT(ISBN) DO UPDATE SET " \
+    publisher " = COALESCE(" publisher ", excluded." publisher "), " \
+    "PublicationDate = COALESCE(PublicationDate, excluded.PublicationDate), " \
+    genre " = COALESCE(" genre ", excluded." genre "), " \
+    language " = COALESCE(" language ", excluded." language "), " \
+    "NumberOfPages = COALESCE(NULLIF(NumberOfPages, 0), excluded.NumberOfPages)"
+
+/* The SQL of each cached statement, indexed by StatementId.*/
+static const char* const statementSql[STMT_CACHE_SIZE] = {
+    INSERT_BOOK_SQL,
+    "DELETE FROM Books WHERE BookID = ? RETURNING ISBN",
+    "SELECT * FROM Books",
+    "SELECT COUNT(*) FROM Books",
+    "SELECT * FROM Books WHERE BookID > ? ORDER BY BookID LIMIT ?",
+    "SELECT * FROM Books WHERE BookID < ? ORDER BY BookID DESC LIMIT ?",
+    "SELECT Books.* FROM BooksSearch JOIN Books ON Books.BookID = BooksSearch.rowid "
+    "WHERE BooksSearch MATCH ? ORDER BY rank LIMIT ?",
+    "SELECT ISBN FROM Books WHERE ISBN IS NOT NULL",
+    "SELECT 1 FROM Books WHERE ISBN = ?",
+    UPSERT_MERGE_SQL(UPSERT_BOOK_SQL, "Author", "Publisher", "Genre", "Language"),
+    UPSERT_FILL_MISSING_SQL(UPSERT_BOOK_SQL, "Publisher", "Genre", "Language"),
+    UPSERT_BOOK_SQL " ON CONFLICT(ISBN) DO NOTHING",
+    "SELECT ISBN FROM Books WHERE BookID = ?",
+    "INSERT OR IGNORE INTO temp.DeleteIds (BookID) VALUES (?)",
+    "DELETE FROM Books WHERE BookID IN (SELECT BookID FROM temp.DeleteIds) RETURNING ISBN",
+    "DELETE FROM temp.DeleteIds",
+    // The counters are kept by the LibraryStats triggers, see createStatsTable
+    "SELECT Books, Pages, "
+    "(SELECT COUNT(*) FROM LibraryStats WHERE Kind = 'author'), "
+    "(SELECT COUNT(*) FROM LibraryStats WHERE Kind = 'genre'), "
+    "(SELECT COUNT(*) FROM LibraryStats WHERE Kind = 'language') "
+    "FROM LibraryStats WHERE Kind = 'total' AND Value = ''",
+    // The books without a value are the ones the counters of the kind miss
+    "SELECT Value, Books, Pages FROM LibraryStats WHERE Kind = ?1 "
+    "UNION ALL SELECT NULL, Total.Books - Counted.Books, Total.Pages - Counted.Pages "
+    "FROM LibraryStats AS Total, (SELECT IFNULL(SUM(Books), 0) AS Books, IFNULL(SUM(Pages), 0) AS Pages "
+    "FROM LibraryStats WHERE Kind = ?1) AS Counted "
+    "WHERE Total.Kind = 'total' AND Total.Value = '' AND Total.Books > Counted.Books "
+    "ORDER BY 2 DESC, 1",
+    // The name tables only exist in a normalized library, see storeNames
+    "INSERT OR IGNORE INTO Authors (Name) VALUES (?)",
+    "INSERT OR IGNORE INTO Publishers (Name) VALUES (?)",
+    "INSERT OR IGNORE INTO Genres (Name) VALUES (?)",
+    "INSERT OR IGNORE INTO Languages (Name) VALUES (?)",
+    PRUNE_NAME_SQL(Author),
+    PRUNE_NAME_SQL(Publisher),
+    PRUNE_NAME_SQL(Genre),
+    PRUNE_NAME_SQL(Language),
+    "SELECT " RECORD_NAME_IDS " FROM BookRecords WHERE BookID = ?",
+    "SELECT " RECORD_NAME_IDS " FROM BookRecords WHERE ISBN = ?",
+    "SELECT " NAME_ID(Author, "?1") ", " NAME_ID(Publisher, "?2") ", " NAME_ID(Genre, "?3") ", "
+    NAME_ID(Language, "?4"),
+    // Writes to a normalized library store names first, see beginBookWrite
+    "SAVEPOINT BookWrite",
+    "ROLLBACK TO BookWrite",
+    "RELEASE BookWrite",
+    "PRAGMA data_version"
+};
+
+/* The statements that write to BookRecords in a normalized library, where
+    Books is a view. Statements left NULL use statementSql, reading through
+    the view.*/
+static const char* const recordSql[STMT_CACHE_SIZE] = {
+    [STMT_INSERT_BOOK] = INSERT_RECORD_SQL,
+    [STMT_DELETE_BOOK] = "DELETE FROM BookRecords WHERE BookID = ? RETURNING ISBN, " RECORD_NAME_IDS,
+    [STMT_COUNT_BOOKS] = "SELECT COUNT(*) FROM BookRecords",
+    [STMT_UPSERT_MERGE] = UPSERT_MERGE_SQL(UPSERT_RECORD_SQL, "AuthorID", "PublisherID", "GenreID", "LanguageID"),
+    [STMT_UPSERT_FILL_MISSING] = UPSERT_FILL_MISSING_SQL(UPSERT_RECORD_SQL, "PublisherID", "GenreID", "LanguageID"),
+    [STMT_UPSERT_KEEP_EXISTING] = UPSERT_RECORD_SQL " ON CONFLICT(ISBN) DO NOTHING",
+    [STMT_DELETE_LISTED] = "DELETE FROM BookRecords WHERE BookID IN (SELECT BookID FROM temp.DeleteIds) "
+                           "RETURNING ISBN, " RECORD_NAME_IDS
+};
+
+/* The tables of a normalized library. Each author, publisher, genre and
+    language is stored once in its name table and BookRecords holds its id.*/
+#define RECORD_TABLES_SQL \
+    "CREATE TABLE IF NOT EXISTS Authors (AuthorID INTEGER PRIMARY KEY, Name TEXT NOT NULL UNIQUE);" \
+    "CREATE TABLE IF NOT EXISTS Publishers (PublisherID INTEGER PRIMARY KEY, Name TEXT NOT NULL UNIQUE);" \
+    "CREATE TABLE IF NOT EXISTS Genres (GenreID INTEGER PRIMARY KEY, Name TEXT NOT NULL UNIQUE);" \
+    "CREATE TABLE IF NOT EXISTS Languages (LanguageID INTEGER PRIMARY KEY, Name TEXT NOT NULL UNIQUE);" \
+    "CREATE TABLE IF NOT EXISTS BookRecords (" \
+        "BookID INTEGER PRIMARY KEY," \
+        "Title TEXT NOT NULL," \
+        "AuthorID INTEGER NOT NULL REFERENCES Authors," \
+        "PublisherID INTEGER REFERENCES Publishers," \
+        "PublicationDate TEXT," \
+        "ISBN TEXT UNIQUE CHECK (LENGTH(ISBN) = 13)," \
+        "GenreID INTEGER REFERENCES Genres," \
+        "LanguageID INTEGER REFERENCES Languages," \
+        "NumberOfPages INTEGER" \
+    ");" \
+    "CREATE INDEX IF NOT EXISTS BookRecordsAuthorPages ON BookRecords(AuthorID, NumberOfPages);" \
+    "CREATE INDEX IF NOT EXISTS BookRecordsPublisher ON BookRecords(PublisherID);" \
+    "CREATE INDEX IF NOT EXISTS BookRecordsGenrePages ON BookRecords(GenreID, NumberOfPages);" \
+    "CREATE INDEX IF NOT EXISTS BookRecordsLanguagePages ON BookRecords(LanguageID, NumberOfPages);"
+
+/* The Books view of a normalized library, which has the columns of the
+    Books table it replaced, so reads and other programs work unchanged.
+    Writes to it are turned into writes to BookRecords.*/
+#define BOOKS_VIEW_SQL \
+    "CREATE VIEW IF NOT EXISTS Books AS SELECT BookID, Title, Authors.Name AS Author, Publishers.Name AS Publisher, " \
+        "PublicationDate, ISBN, Genres.Name AS Genre, Languages.Name AS Language, NumberOfPages " \
+        "FROM BookRecords LEFT JOIN Authors USING (AuthorID) LEFT JOIN Publishers USING (PublisherID) " \
+        "LEFT JOIN Genres USING (GenreID) LEFT JOIN Languages USING (LanguageID);" \
+    "CREATE TRIGGER IF NOT EXISTS BooksInsert INSTEAD OF INSERT ON Books BEGIN " \
+        STORE_NAMES("new") \
+        "INSERT INTO BookRecords VALUES (" RECORD_VALUES("new") "); " \
+    "END;" \
+    "CREATE TRIGGER IF NOT EXISTS BooksUpdate INSTEAD OF UPDATE ON Books BEGIN " \
+        STORE_NAMES("new") \
+        "UPDATE BookRecords SET (BookID, Title, AuthorID, PublisherID, PublicationDate, ISBN, GenreID, " \
+        "LanguageID, NumberOfPages) = (" RECORD_VALUES("new") ") WHERE BookID = old.BookID; " \
+    "END;" \
+    "CREATE TRIGGER IF NOT EXISTS BooksDelete INSTEAD OF DELETE ON Books BEGIN " \
+        "DELETE FROM BookRecords WHERE BookID = old.BookID; " \
+    "END;"
+
+/* Triggers on the Books table of a library being migrated, which copy every
+    change to BookRecords so rows copied earlier never go stale.*/
+#define SYNC_TRIGGERS_SQL \
+    "CREATE TRIGGER IF NOT EXISTS BookRecordsSyncInsert AFTER INSERT ON Books BEGIN " \
+        STORE_NAMES("new") \
+        "INSERT OR REPLACE INTO BookRecords VALUES (" RECORD_VALUES("new") "); " \
+    "END;" \
+    "CREATE TRIGGER IF NOT EXISTS BookRecordsSyncUpdate AFTER UPDATE ON Books BEGIN " \
+        "DELETE FROM BookRecords WHERE BookID = old.BookID; " \
+        STORE_NAMES("new") \
+        "INSERT OR REPLACE INTO BookRecords VALUES (" RECORD_VALUES("new") "); " \
+    "END;" \
+    "CREATE TRIGGER IF NOT EXISTS BookRecordsSyncDelete AFTER DELETE ON Books BEGIN " \
+        "DELETE FROM BookRecords WHERE BookID = old.BookID; " \
+    "END;"
+
+/* The statements of one batch of the migration, copying the Books rows
+    with ids in (?1, ?2] into the name tables and BookRecords. Rows already
+    copied by the sync triggers are kept.*/
+static const char* const migrateBatchSql[] = {
+    "INSERT OR IGNORE INTO Authors (Name) SELECT Author FROM Books WHERE BookID > ?1 AND BookID <= ?2",
+    "INSERT OR IGNORE INTO Publishers (Name) SELECT Publisher FROM Books WHERE BookID > ?1 AND BookID <= ?2",
+    "INSERT OR IGNORE INTO Genres (Name) SELECT Genre FROM Books WHERE BookID > ?1 AND BookID <= ?2",
+    "INSERT OR IGNORE INTO Languages (Name) SELECT Language FROM Books WHERE BookID > ?1 AND BookID <= ?2",
+    // Must stay last, its changes are the books copied
+    "INSERT OR IGNORE INTO BookRecords SELECT " RECORD_VALUES("Books") " FROM Books "
+    "WHERE BookID > ?1 AND BookID <= ?2"
+};
+#define MIGRATE_BATCH_STATEMENTS (sizeof(migrateBatchSql) / sizeof(migrateBatchSql[0]))
+
+/* The full-text index over the Title, Author, Publisher and Genre of Books.
+    It is an external content table, the text itself stays in Books.*/
+#define SEARCH_TABLE_SQL \
+    "CREATE VIRTUAL TABLE BooksSearch USING fts5(" \
+        "Title, Author, Publisher, Genre, content='Books', content_rowid='BookID');"
+
+/* The values BooksSearch indexes for a row, held in row, of Books or of
+    BookRecords.*/
+#define BOOK_SEARCH_VALUES(row) row ".Title, " row ".Author, " row ".Publisher, " row ".Genre"
+#define RECORD_SEARCH_VALUES(row) \
+    row ".Title, " NAME_OF(Author, row) ", " NAME_OF(Publisher, row) ", " NAME_OF(Genre, row)
+
+/* The triggers that keep BooksSearch in sync with a table, given the macro
+    that gets the indexed values of one of its rows.*/
+#define SEARCH_TRIGGERS_SQL(table, values) \
+    "CREATE TRIGGER BooksSearchInsert AFTER INSERT ON " table " BEGIN " \
+        "INSERT INTO BooksSearch(rowid, Title, Author, Publisher, Genre) " \
+        "VALUES (new.BookID, " values("new") "); " \
+    "END;" \
+    "CREATE TRIGGER BooksSearchDelete AFTER DELETE ON " table " BEGIN " \
+        "INSERT INTO BooksSearch(BooksSearch, rowid, Title, Author, Publisher, Genre) " \
+        "VALUES ('delete', old.BookID, " values("old") "); " \
+    "END;" \
+    "CREATE TRIGGER BooksSearchUpdate AFTER UPDATE ON " table " BEGIN " \
+        "INSERT INTO BooksSearch(BooksSearch, rowid, Title, Author, Publisher, Genre) " \
+        "VALUES ('delete', old.BookID, " values("old") "); " \
+        "INSERT INTO BooksSearch(rowid, Title, Author, Publisher, Genre) " \
+        "VALUES (new.BookID, " values("new") "); " \
+    "END;"
+
+/* Reindexes the books that have a name when the name is renamed in the name
+    table of a field. The old text is taken out before the rename, while the
+    view still shows it.*/
+#define SEARCH_RENAME_SQL(field) \
+    "CREATE TRIGGER BooksSearchUnname" #field " BEFORE UPDATE OF Name ON " #field "s BEGIN " \
+        "INSERT INTO BooksSearch(BooksSearch, rowid, Title, Author, Publisher, Genre) " \
+        "SELECT 'delete', BookID, Title, Author, Publisher, Genre FROM Books WHERE " #field " = old.Name; " \
+    "END;" \
+    "CREATE TRIGGER BooksSearchRename" #field " AFTER UPDATE OF Name ON " #field "s BEGIN " \
+        "INSERT INTO BooksSearch(rowid, Title, Author, Publisher, Genre) " \
+        "SELECT BookID, Title, Author, Publisher, Genre FROM Books WHERE " #field " = new.Name; " \
+    "END;"
+
+#define BOOK_SEARCH_TRIGGERS_SQL SEARCH_TRIGGERS_SQL("Books", BOOK_SEARCH_VALUES)
+#define RECORD_SEARCH_TRIGGERS_SQL \
+    SEARCH_TRIGGERS_SQL("BookRecords", RECORD_SEARCH_VALUES) \
+    SEARCH_RENAME_SQL(Author) SEARCH_RENAME_SQL(Publisher) SEARCH_RENAME_SQL(Genre)
+
+/* The table getLibraryStats reads. Kind is 'total' (with Value ''), 'author',
+    'genre' or 'language'.*/
+#define STATS_TABLE_SQL \
+    "CREATE TABLE LibraryStats (" \
+        "Kind TEXT NOT NULL, Value TEXT NOT NULL, Books INTEGER NOT NULL, Pages INTEGER NOT NULL, " \
+        "PRIMARY KEY (Kind, Value)) WITHOUT ROWID;"
+
+/* Counts a book, held in row, under a value of it.*/
+#define STATS_ADD(kind, value, row) \
+    "INSERT INTO LibraryStats (Kind, Value, Books, Pages) " \
+    "SELECT '" kind "', " value ", 1, COALESCE(" row ".NumberOfPages, 0) WHERE " value " IS NOT NULL " \
+    "ON CONFLICT (Kind, Value) DO UPDATE SET Books = Books + 1, Pages = Pages + excluded.Pages; "
+
+/* Uncounts the old book under a value of it, dropping values no book has
+    any more.*/
+#define STATS_REMOVE(kind, value) \
+    "UPDATE LibraryStats SET Books = Books - 1, Pages = Pages - COALESCE(old.NumberOfPages, 0) " \
+    "WHERE Kind = '" kind "' AND Value = " value "; " \
+    "DELETE FROM LibraryStats WHERE Kind = '" kind "' AND Value = " value " AND Books = 0; "
+
+/* The triggers that keep LibraryStats up to date with a table, given the
+    columns that change the counts and the macro that gets the value a row
+    has for a field.*/
+#define STATS_TRIGGERS_SQL(table, columns, value) \
+    "CREATE TRIGGER LibraryStatsInsert AFTER INSERT ON " table " BEGIN " \
+        "UPDATE LibraryStats SET Books = Books + 1, Pages = Pages + COALESCE(new.NumberOfPages, 0) " \
+        "WHERE Kind = 'total' AND Value = ''; " \
+        STATS_ADD("author", value(Author, "new"), "new") \
+        STATS_ADD("genre", value(Genre, "new"), "new") \
+        STATS_ADD("language", value(Language, "new"), "new") \
+    "END;" \
+    "CREATE TRIGGER LibraryStatsDelete AFTER DELETE ON " table " BEGIN " \
+        "UPDATE LibraryStats SET Books = Books - 1, Pages = Pages - COALESCE(old.NumberOfPages, 0) " \
+        "WHERE Kind = 'total' AND Value = ''; " \
+        STATS_REMOVE("author", value(Author, "old")) \
+        STATS_REMOVE("genre", value(Genre, "old")) \
+        STATS_REMOVE("language", value(Language, "old")) \
+    "END;" \
+    "CREATE TRIGGER LibraryStatsUpdate AFTER UPDATE OF " columns " ON " table " BEGIN " \
+        "UPDATE LibraryStats SET Pages = Pages - COALESCE(old.NumberOfPages, 0) + COALESCE(new.NumberOfPages, 0) " \
+        "WHERE Kind = 'total' AND Value = ''; " \
+        STATS_REMOVE("author", value(Author, "old")) \
+        STATS_REMOVE("genre", value(Genre, "old")) \
+        STATS_REMOVE("language", value(Language, "old")) \
+        STATS_ADD("author", value(Author, "new"), "new") \
+        STATS_ADD("genre", value(Genre, "new"), "new") \
+        STATS_ADD("language", value(Language, "new"), "new") \
+    "END;"
+
+/* Moves the counts of a name to its new name when it is renamed in the name
+    table of a field.*/
+#define STATS_RENAME_SQL(field, kind) \
+    "CREATE TRIGGER LibraryStatsRename" #field " AFTER UPDATE OF Name ON " #field "s BEGIN " \
+        "UPDATE LibraryStats SET Value = new.Name WHERE Kind = '" kind "' AND Value = old.Name; " \
+    "END;"
+
+#define BOOK_STATS_TRIGGERS_SQL STATS_TRIGGERS_SQL("Books", "Author, Genre, Language, NumberOfPages", BOOK_VALUE)
+#define RECORD_STATS_TRIGGERS_SQL \
+    STATS_TRIGGERS_SQL("BookRecords", "AuthorID, GenreID, LanguageID, NumberOfPages", NAME_OF) \
+    STATS_RENAME_SQL(Author, "author") STATS_RENAME_SQL(Genre, "genre") STATS_RENAME_SQL(Language, "language")
+
+/* Fills LibraryStats from the Books table.*/
+#define STATS_REBUILD_SQL \
+    "DELETE FROM LibraryStats;" \
+    "INSERT INTO LibraryStats SELECT 'total', '', COUNT(*), COALESCE(SUM(NumberOfPages), 0) FROM Books;" \
+    "INSERT INTO LibraryStats SELECT 'author', Author, COUNT(*), COALESCE(SUM(NumberOfPages), 0) " \
+    "FROM Books WHERE Author IS NOT NULL GROUP BY Author;" \
+    "INSERT INTO LibraryStats SELECT 'genre', Genre, COUNT(*), COALESCE(SUM(NumberOfPages), 0) " \
+    "FROM Books WHERE Genre IS NOT NULL GROUP BY Genre;" \
+    "INSERT INTO LibraryStats SELECT 'language', Language, COUNT(*), COALESCE(SUM(NumberOfPages), 0) " \
+    "FROM Books WHERE Language IS NOT NULL GROUP BY Language;"
+
+/* Removes every name that no book has from the name tables.*/
+#define PRUNE_NAMES_SQL \
+    "DELETE FROM Authors WHERE NOT EXISTS (SELECT 1 FROM BookRecords WHERE AuthorID = Authors.AuthorID);" \
+    "DELETE FROM Publishers WHERE NOT EXISTS (SELECT 1 FROM BookRecords WHERE PublisherID = Publishers.PublisherID);" \
+    "DELETE FROM Genres WHERE NOT EXISTS (SELECT 1 FROM BookRecords WHERE GenreID = Genres.GenreID);" \
+    "DELETE FROM Languages WHERE NOT EXISTS (SELECT 1 FROM BookRecords WHERE LanguageID = Languages.LanguageID);"
+
+/* Milliseconds migrateSchema waits between batches, so writers on other
+    connections get the write lock in between.*/
+#define MIGRATE_PAUSE_MS 10
+
+/* Milliseconds a connection waits for another connection's write lock.*/
+#define BUSY_TIMEOUT_MS 5000
+
+/* The PRAGMA user_version of a library createTable has set up. Opening a
+    library at this version runs no DDL.*/
+#define SCHEMA_VERSION 1
+
+/* The number of string fields inside BookData.*/
+#define BOOK_TEXT_FIELDS 7
+
+/* A live query over the Books table. The text fields of the current row
+    are copied into buffers owned by the cursor, which are reused for every
+    row so walking the table takes constant memory.*/
+struct BookCursor {
+    sqlite3_stmt* stmt;
+    /* 1 if stmt was prepared for this cursor and must be finalized,
+        0 if it belongs to the statement cache*/
+    int ownsStatement;
+    char* buffers[BOOK_TEXT_FIELDS];
+    size_t capacities[BOOK_TEXT_FIELDS];
+};
+
+/* Size of each chunk allocated by a BookArena.*/
+#define ARENA_CHUNK_SIZE (64 * 1024)
+/* Alignment of every allocation made from a BookArena.*/
+#define ARENA_ALIGNMENT 16
+
+/* A block of memory that arena allocations are bumped out of.*/
+typedef struct ArenaChunk {
+    struct ArenaChunk* next;
+    size_t size;
+    size_t used;
+    _Alignas(ARENA_ALIGNMENT) char data[];
+} ArenaChunk;
+
+/* Number of slots of the smallest intern table.*/
+#define MIN_INTERN_CAPACITY 256
+
+/* The fields an arena interns. They hold few distinct values, so most books
+    share their string with an earlier book.*/
+#define INTERNED_FIELDS (BOOK_FIELD_AUTHOR | BOOK_FIELD_PUBLISHER | BOOK_FIELD_GENRE | BOOK_FIELD_LANG)
+
+/* A slot of an arena's intern table, empty when text is NULL.*/
+typedef struct {
+    const char* text;
+    uint32_t hash;
+    uint32_t length;
+} InternSlot;
+
+/* Owns all memory of a BookArray made by getBooksArena. Rows and strings
+    live in separate chunk lists so the BookData structs sit next to each
+    other in memory.*/
+struct BookArena {
+    ArenaChunk* rows;
+    ArenaChunk* strings;
+    /* Chunks kept by resetArena that are handed out before allocating new ones*/
+    ArenaChunk* spare;
+    /* Open addressing table of the strings of INTERNED_FIELDS, which live in
+        the string chunks. The capacity is always a power of two*/
+    InternSlot* interned;
+    size_t internCapacity;
+    size_t internCount;
+    InternStats internStats;
+};
+
+/* Capacity of a BookArray's pointer array the first time it grows.*/
+#define MIN_BOOK_CAPACITY 16
+/* The most books loadPage makes room for before the rows arrive, a larger
+    limit grows the array as the page is read.*/
+#define PAGE_PRESIZE 256
+
+/* The name ids of books a write removed, changed or failed to add, whose
+    names may be left without books, see pruneNames.*/
+typedef struct {
+    /* The author, publisher, genre and language ids of each book, in
+        RECORD_NAME_IDS order*/
+    int64_t (*rows)[4];
+    size_t count;
+    size_t capacity;
+    /* Set when a book could not be added, so every name is checked instead*/
+    int overflowed;
+} NameIdList;
+
+/* A statement whose SQL is built at run time, such as one per filter shape,
+    cached under a key describing that shape.*/
+typedef struct {
+    unsigned key;
+    sqlite3_stmt* stmt;
+} ShapeStatement;
+
+/* Kinds of shape statements, stored in the high bits of the cache key.*/
+#define SHAPE_SELECT_WHERE (1u << 16)
+#define SHAPE_UPDATE (1u << 17)
+#define SHAPE_DELETE_WHERE (1u << 18)
+#define SHAPE_RENAME (1u << 19)
+
+/* Room needed for the WHERE clause written by appendFilterWhere.*/
+#define FILTER_SQL_SIZE 64
+/* Room needed for the SELECT written by appendSelectFields.*/
+#define SELECT_SQL_SIZE 128
+/* Room needed for the UPDATE built by updateBook.*/
+#define UPDATE_SQL_SIZE 384
+/* Filter shapes use the low bits of a SHAPE_SELECT_WHERE key, the field
+    mask sits above them.*/
+#define FILTER_SHAPE_BITS 3
+
+/* The column of each BOOK_FIELD_* bit, in bit order.*/
+static const char* const fieldColumns[] = {
+    "Title", "Author", "Publisher", "PublicationDate", "ISBN", "Genre", "Language", "NumberOfPages"
+};
+
+/* What updateBook sets for each BOOK_FIELD_* bit in a normalized library,
+    in bit order.*/
+static const char* const recordSetters[] = {
+    "Title = ?", "AuthorID = " NAME_ID(Author, "?"), "PublisherID = " NAME_ID(Publisher, "?"),
+    "PublicationDate = ?", "ISBN = ?", "GenreID = " NAME_ID(Genre, "?"),
+    "LanguageID = " NAME_ID(Language, "?"), "NumberOfPages = ?"
+};
+
+/* The fields whose values are kept in name tables in a normalized library.*/
+#define NAME_FIELDS (BOOK_FIELD_AUTHOR | BOOK_FIELD_PUBLISHER | BOOK_FIELD_GENRE | BOOK_FIELD_LANG)
+
+/* Bits of a filter shape, one for each filter field that is set.*/
+#define FILTER_AUTHOR 1u
+#define FILTER_GENRE 2u
+#define FILTER_LANG 4u
+
+/* An open library database. Owns the sqlite connection along with every
+    statement prepared on it, so separate handles share nothing and can be
+    used from different threads.*/
+struct LibraryDb {
+    sqlite3* db;
+    /* Statements owned by the connection, finalized in libraryClose*/
+    sqlite3_stmt* statementCache[STMT_CACHE_SIZE];
+    StatementCacheStats cacheStats;
+    /* Statements built for a query shape, finalized in libraryClose*/
+    ShapeStatement* shapeCache;
+    int shapeCacheCount;
+    int shapeCacheCapacity;
+    /* Number of rows addBooks inserts before committing a transaction*/
+    size_t batchCommitSize;
+    /* The ISBN of every book, or NULL unless opened with LIBRARY_ISBN_INDEX*/
+    IsbnSet* isbnIndex;
+    /* The data_version of the connection when it last checked for commits
+        made by other connections, see checkDataVersion*/
+    long long dataVersion;
+    /* 1 once the temp table used by deleteBooksByIds has been created*/
+    int deleteIdsReady;
+    /* 1 if the library is normalized, Books being a view over BookRecords
+        and the name tables, see migrateSchema*/
+    int normalized;
+};
+
+/* The handle used by the functions that do not take a LibraryDb, opened
+    by makeConnection and closed by closeConnection.*/
+static LibraryDb* defaultLibrary;
+
+/**
+ * Fills the ISBN index of a library with the ISBN of every stored book.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int loadIsbnIndex(LibraryDb* library);
+/**
+ * Checks whether other connections, such as a write queue or another
+ * process, committed changes since the last call.
+ * @returns 1 if they did, else returns 0.
+*/
+static int checkDataVersion(LibraryDb* library);
+/**
+ * Catches up with changes other connections committed since the last call.
+ * When another connection migrated the library, the statements prepared for
+ * the old schema are dropped, and the ISBN index is reloaded. Called before
+ * each write, as the SQL of the writes depends on the schema.
+*/
+static void syncLibrary(LibraryDb* library);
+/**
+ * Checks whether any statement of a library is part way through its rows.
+ * @returns 1 if one is, else returns 0.
+*/
+static int statementsBusy(LibraryDb* library);
+/**
+ * Checks whether a book already has an ISBN. The ISBN index answers
+ * misses without asking the database, a hit is only a hint and is
+ * confirmed with the ISBN lookup in the database.
+ * @returns 1 if a stored book has the ISBN, else returns 0, including when
+ *          the library has no ISBN index.
+*/
+static int isbnIndexed(LibraryDb* library, const char* isbn);
+/**
+ * Looks up an ISBN in the database.
+ * @returns 1 if a stored book has the ISBN, 0 if none has, else returns -1.
+*/
+static int findIsbn(LibraryDb* library, const char* isbn);
+/**
+ * Adds an ISBN to the ISBN index of a library, if it has one. If the index
+ * cannot grow it is dropped, so it is never missing a stored ISBN.
+*/
+static void indexIsbn(LibraryDb* library, const char* isbn);
+/**
+ * Creates the default tables. A new library gets the normalized tables,
+ * a library with a Books table keeps it. Does nothing but read the kind of
+ * library once the library is at SCHEMA_VERSION.
+*/
+static void createTable(LibraryDb* library);
+/**
+ * Gets the PRAGMA user_version of a library.
+ * @returns The version, or 0 if it could not be read.
+*/
+static int schemaVersion(LibraryDb* library);
+/**
+ * Checks whether the schema has a table, view, index or trigger.
+ * @param name The name of the object.
+ * @param type The type of the object, e.g. "view", or NULL for any type.
+ * @returns 1 if it has, else returns 0.
+*/
+static int hasSchemaObject(LibraryDb* library, const char* name, const char* type);
+/**
+ * Adds the author, publisher, genre and language of a book that are in a
+ * field mask to the name tables of a normalized library, so the statements
+ * of recordSql find their ids. Does nothing for a library that is not
+ * normalized.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int storeNames(LibraryDb* library, const BookData* data, uint32_t fieldMask);
+/**
+ * Opens the savepoint a write to a normalized library runs under, so the
+ * names storeNames adds are undone along with a write that fails. Does
+ * nothing for a library that is not normalized.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int beginBookWrite(LibraryDb* library);
+/**
+ * Closes the savepoint opened by beginBookWrite, first undoing everything
+ * written under it unless the write succeeded.
+ * @param succeeded 1 if the write succeeded, else 0.
+ * @returns 1 if the write succeeded and was kept, else returns 0.
+*/
+static int endBookWrite(LibraryDb* library, int succeeded);
+/**
+ * Runs a cached statement that returns no rows.
+ * @returns The result code of sqlite3_step, SQLITE_DONE if it succeeded.
+*/
+static int stepStatement(LibraryDb* library, StatementId id);
+/**
+ * Reads the author, publisher, genre and language ids of a book from four
+ * columns of the current row of a statement, in RECORD_NAME_IDS order.
+ * @param column The first of the columns.
+ * @param nameIds Receives the ids, 0 where the book has no name.
+*/
+static void readNameIds(sqlite3_stmt* stmt, int column, int64_t nameIds[4]);
+/**
+ * Gets the name ids a stored book has before a write that may change them.
+ * @param stmt STMT_NAME_IDS_BY_ID or STMT_NAME_IDS_BY_ISBN with the book
+ *          bound, or NULL. The statement is released.
+ * @param nameIds Receives the ids, all 0 if the book is not stored.
+*/
+static void storedNameIds(sqlite3_stmt* stmt, int64_t nameIds[4]);
+/**
+ * Adds the name ids of a book to a NameIdList, growing the list when it is
+ * full. If it cannot grow the list is marked overflowed.
+*/
+static void addNameIds(NameIdList* list, const int64_t nameIds[4]);
+/**
+ * Frees the rows of a NameIdList and empties it.
+*/
+static void freeNameIds(NameIdList* list);
+/**
+ * Removes names that no book has anymore from the name tables of a
+ * normalized library, with one statement per name table. A name that
+ * cannot be removed is only printed to stderr, as it does no harm and
+ * rebuildStats removes it later.
+ * @param list The ids that may have lost their last book, 0 to skip one.
+*/
+static void pruneNames(LibraryDb* library, const NameIdList* list);
+/**
+ * Removes a name from the name table of a field of a normalized library,
+ * unless a book still has it, see pruneNames.
+ * @param field The BOOK_FIELD_* bit of the field.
+ * @param column The column of the field in Books, e.g. "Author".
+*/
+static void pruneName(LibraryDb* library, uint32_t field, const char* column, const char* name);
+/**
+ * Copies the Books table of a library being migrated into BookRecords, one
+ * transaction of at most batchSize books at a time.
+ * @returns 1 if every book was copied, else returns 0.
+*/
+static int copyBookRecords(LibraryDb* library, int batchSize, MigrationReport* report);
+/**
+ * Swaps the Books table of a migrated library for the Books view and moves
+ * the search and stats triggers to BookRecords, in one transaction.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int replaceBooksTable(LibraryDb* library);
+/**
+ * Applies the pragmas of a connection profile to the open connection. A
+ * pragma that fails is printed to stderr and the rest are still applied.
+ * @param profile The profile to apply.
+*/
+static void applyProfile(LibraryDb* library, const ConnectionProfile* profile);
+/**
+ * Gets the number of pages in the database file.
+ * @returns The page count, 0 for a new database, or -1 if it could not be read.
+*/
+static int countPages(LibraryDb* library);
+/**
+ * Creates the BooksSearch full-text index over the Title, Author, Publisher
+ * and Genre of every book, along with the triggers that keep it in sync with
+ * the Books table. Books already stored are indexed when it is first created.
+ * @returns 1 if the index exists, else returns 0.
+*/
+static int createSearchIndex(LibraryDb* library);
+/**
+ * Creates the LibraryStats table, which holds the number of books and pages
+ * in total and for each author, genre and language, along with the triggers
+ * that keep it up to date. It is filled from the Books table when it is
+ * first created.
+ * @returns 1 if the table exists, else returns 0.
+*/
+static int createStatsTable(LibraryDb* library);
+/**
+ * Turns text typed by the user into an FTS5 query where every word must
+ * match, quoting each word so characters such as - or " are not read as
+ * query syntax. The last word also matches as a prefix.
+ * @param text The text typed by the user.
+ * @returns The query, which must be freed, or NULL if text has no words or
+ *          memory could not be allocated.
+*/
+static char* buildMatchQuery(const char* text);
+/**
+ * Gets the SQL of a cached statement for the schema of a library.
+*/
+static const char* statementText(const LibraryDb* library, StatementId id);
+/**
+ * Gets a prepared statement from the statement cache. The statement is
+ * prepared the first time it is requested and reused on every call after.
+ * 
+ * @param id The StatementId of the statement wanted.
+ * @returns The prepared statement, or NULL if the statement could not be
+ *          prepared. The statement must be handed back with releaseStatement.
+*/
+static sqlite3_stmt* getStatement(LibraryDb* library, StatementId id);
+/**
+ * Resets a cached statement and clears its bindings so it is ready for
+ * the next call to getStatement.
+ * @param stmt The statement retrieved from getStatement.
+*/
+static void releaseStatement(sqlite3_stmt* stmt);
+/**
+ * Gets a statement from the shape cache, preparing it from sql the first time
+ * the key is seen. The number of keys is bounded by the number of query
+ * shapes, so the cache never needs to evict.
+ * @param key Identifies the shape, a SHAPE_ kind combined with shape bits.
+ * @param sql The SQL for the shape, only used when the key is not cached.
+ * @returns The prepared statement, or NULL if it could not be prepared. The
+ *          statement must be handed back with releaseStatement.
+*/
+static sqlite3_stmt* getShapeStatement(LibraryDb* library, unsigned key, const char* sql);
+/**
+ * Gets the shape of a filter, which has a FILTER_ bit set for each field
+ * of the filter that is not NULL.
+*/
+static unsigned filterShape(const BookFilter* filter);
+/**
+ * Appends the WHERE clause for a filter shape to an SQL statement. The
+ * clause has one parameter per set field, in the order author, genre, lang.
+ * @param sql The SQL to append to, must have room for FILTER_SQL_SIZE more bytes.
+ * @param shape The filter shape from filterShape.
+*/
+static void appendFilterWhere(char* sql, unsigned shape);
+/**
+ * Writes "SELECT BookID, <columns> FROM Books" into sql for the columns of
+ * a field mask.
+*/
+static void appendSelectFields(char* sql, uint32_t fields);
+/**
+ * Gets the statement that selects the fields of the books matching a
+ * filter shape, ordered by BookID.
+ * @returns The cached statement, or NULL if it could not be prepared. sql
+ *          holds its SQL either way.
+*/
+static sqlite3_stmt* getSelectWhere(LibraryDb* library, unsigned shape, uint32_t fields, char* sql);
+/**
+ * Binds the set fields of a filter to the parameters added by appendFilterWhere.
+ * @param stmt The statement to bind to.
+ * @param filter The filter. May be NULL if the shape is 0.
+ * @param index The parameter index of the first filter parameter.
+ * @returns The parameter index after the filter parameters.
+*/
+static int bindFilter(sqlite3_stmt* stmt, const BookFilter* filter, int index);
 /**
- * Creates the default tables
+ * Finalizes every statement inside the statement cache.
 */
-static void createTable(void);
+static void clearStatementCache(LibraryDb* library);
+/**
+ * Binds the fields of a book to the parameters of the insert statement.
+ * The strings are bound as SQLITE_STATIC so the book must outlive the step.
+ * @param stmt The insert statement.
+ * @param data The book to bind.
+*/
+static void bindBook(sqlite3_stmt* stmt, const BookData* data);
+/**
+ * Gets the stored ISBN of a book.
+ * @param isbn Receives the ISBN, which must have room for 14 bytes. Left
+ *          empty if the book has no ISBN or it is not 13 characters.
+ * @returns 1 if the book exists, else returns 0.
+*/
+static int storedIsbn(LibraryDb* library, int64_t id, char* isbn);
+/**
+ * Steps a DELETE ... RETURNING ISBN statement to the end, taking each deleted
+ * ISBN out of the ISBN index. The statement is released afterwards.
+ * @returns The number of rows deleted, or -1 if the delete failed.
+*/
+static long runDelete(LibraryDb* library, sqlite3_stmt* stmt);
+/**
+ * Copies a text column of the current row into a cursor buffer, growing the
+ * buffer only when the column does not fit.
+ * @param cursor The cursor that owns the buffer.
+ * @param field The index of the buffer, 0 for title through 6 for lang.
+ * @param column The column of the row to copy.
+ * @param dest Set to the buffer, or NULL if the column is NULL.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int copyCursorField(BookCursor* cursor, int field, int column, char** dest);
+/**
+ * Points a BookView at the columns of the current row of a statement, which
+ * selects BookID followed by the columns in the fields mask.
+*/
+static void readView(sqlite3_stmt* stmt, BookView* view, uint32_t fields);
+/**
+ * Executes a single SQL command that produces no rows, such as BEGIN or COMMIT.
+ * Will print error to stderr if the command fails.
+ * @param sql The SQL command to execute.
+ * @returns OPERATION_SUCCESS if the command ran, else returns OPERATION_FAIL.
+*/
+static int execCommand(LibraryDb* library, const char* sql);
 /**
  * For allocating memory to dest, the same size as src with null-terminator. Will
  * print error to stderr if unable to allocate memory.
  * 
  * @param dest A pointer to a pointer to a character array. Memory will be allocated
  *              to this pointer, the size of the character array src.
- * @param src The source character array that contains the characters to be copied
+ * @param src The source character array that contains the characters to be copied.
+ *              If src is NULL dest is set to NULL.
+ * @param arena The arena to take the memory from, or NULL to use malloc.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int copyField(char** dest, const unsigned char* src, BookArena* arena);
+/**
+ * Points dest at the arena's copy of src, copying src into the arena only the
+ * first time the arena sees it, so equal fields share one string.
+ * @param dest Receives the shared string, or NULL if src is NULL.
+ * @param src The text to intern. May be NULL.
+ * @param arena The arena that owns the string and the intern table.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int internField(char** dest, const unsigned char* src, BookArena* arena);
+/**
+ * Moves every interned string into a table with the given number of slots.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int resizeInternTable(BookArena* arena, size_t capacity);
+/**
+ * Reads every row of the Books table into a BookArray, replacing the rows it
+ * already holds. Does the work of getBooks, getBooksArena and reloadBooks.
+ * Rows and fields are allocated from array->arena, or with malloc if the
+ * arena is NULL.
+ * @param array The BookArray to fill. Its pointer array is reused and only
+ *          grown when the rows do not fit.
+ * @param presize If not 0 the rows are counted first so the pointer array
+ *          is grown at most once.
+ * @returns OPERATION_SUCCESS if the rows were read, else returns
+ *          OPERATION_FAIL and leaves the array with no rows.
+*/
+static int loadBooks(LibraryDb* library, BookArray* array, int presize);
+/**
+ * Reads one page of books with a keyset query into a BookArray, replacing
+ * the rows it already holds.
+ * @param id STMT_SELECT_PAGE_AFTER or STMT_SELECT_PAGE_BEFORE.
+ * @param boundaryId The BookID the page starts after or ends before.
+ * @param limit The most books the page holds.
+ * @param out The BookArray to fill.
+ * @returns OPERATION_SUCCESS if the page was read, else returns OPERATION_FAIL.
+*/
+static int loadPage(LibraryDb* library, StatementId id, int64_t boundaryId, int limit, BookArray* out);
+/**
+ * Reads every row produced by a bound select statement into a BookArray,
+ * after the rows it already holds. The statement is released afterwards.
+ * @param array The BookArray to append to.
+ * @param stmt The select statement, returning BookID followed by the columns
+ *          of the fields mask. With BOOK_FIELD_ALL that is SELECT * FROM Books.
+ * @param fields The BOOK_FIELD_* bits of the columns selected, the other fields are left NULL.
+ * @returns OPERATION_SUCCESS if every row was read, else returns
+ *          OPERATION_FAIL and leaves the array with no rows.
+*/
+static int readRows(LibraryDb* library, BookArray* array, sqlite3_stmt* stmt, uint32_t fields);
+/**
+ * Counts the rows of the Books table.
+ * @returns The number of rows, or 0 if they could not be counted.
+*/
+static int countBooks(LibraryDb* library);
+/**
+ * Grows the pointer array of a BookArray geometrically.
+ * @param array The BookArray to grow.
+ * @param minCapacity The least number of books the array must be able to hold.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int growBooks(BookArray* array, int minCapacity);
+/**
+ * Grows the per book arrays of a BookColumns geometrically.
+ * @param columns The BookColumns to grow.
+ * @param minCapacity The least number of books it must be able to hold.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int growColumns(BookColumns* columns, int minCapacity);
+/**
+ * Appends the text of a book to a column and records where it ends.
+ * @param column The column to append to.
+ * @param row The index of the book, which must be the next one.
+ * @param text The text, or NULL to store a NULL field.
+ * @param length The length of text in bytes.
  * @returns 1 if operation was successful, else returns 0.
 */
-static int copyField(char** dest, const char* src);
+static int appendColumnText(BookColumn* column, int row, const unsigned char* text, size_t length);
+/**
+ * Frees the rows of a BookArray but keeps its pointer array, and its arena
+ * chunks if it has an arena, so they can be filled again.
+*/
+static void clearRows(BookArray* array);
+/**
+ * Frees a single book allocated with malloc along with its fields.
+*/
+static void freeBook(BookData* book);
+/**
+ * Bump allocates memory from the front chunk of a chunk list. When the front
+ * chunk is full a spare chunk of the arena is reused, or a new chunk of
+ * ARENA_CHUNK_SIZE bytes (or larger for oversized requests) is allocated.
+ * @param arena The arena that owns the chunk list.
+ * @param head The head of the chunk list.
+ * @param size The number of bytes wanted.
+ * @returns The memory, or NULL if a new chunk could not be allocated.
+*/
+static void* arenaAlloc(BookArena* arena, ArenaChunk** head, size_t size);
+/**
+ * Frees a chunk list.
+*/
+static void freeChunks(ArenaChunk* chunk);
+/**
+ * Empties an arena, keeping its standard sized chunks as spares for reuse.
+*/
+static void resetArena(BookArena* arena);
+/**
+ * Frees an arena along with all the chunks it owns.
+*/
+static void freeArena(BookArena* arena);
+
+LibraryDb* libraryOpen(const char* path, int flags) {
+    ConnectionProfile profile = connectionProfilePreset(PROFILE_DURABLE);
+    return libraryOpenEx(path, flags, &profile);
+}
+
+LibraryDb* libraryOpenEx(const char* path, int flags, const ConnectionProfile* profile) {
+    LibraryDb* library = calloc(1, sizeof(LibraryDb));
+    if (library == NULL) {
+        fprintf(stderr, "Error Allocating Memory in libraryOpen\n");
+        return NULL;
+    }
+    library->batchCommitSize = DEFAULT_BATCH_COMMIT_SIZE;
+
+    // Each handle is only used by one thread at a time, so sqlite's own mutexes are not needed
+    int openFlags = SQLITE_OPEN_NOMUTEX;
+    openFlags |= (flags & LIBRARY_READONLY) ? SQLITE_OPEN_READONLY
+                                            : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+
+    // Open a db connection and check to make sure it worked
+    int rc = sqlite3_open_v2(path, &library->db, openFlags, NULL);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot open database: %s\n", sqlite3_errmsg(library->db));
+        sqlite3_close(library->db);
+        free(library);
+        return NULL;
+    }
+    // Other handles on the same file may hold the write lock for a moment
+    sqlite3_busy_timeout(library->db, BUSY_TIMEOUT_MS);
+
+    // Tuning must come before createTable so page_size applies to new databases
+    if (profile != NULL) {
+        ConnectionProfile tuning = *profile;
+        if (flags & LIBRARY_READONLY) {
+            // A read only connection cannot change the database file
+            tuning.journalMode = NULL;
+            tuning.pageSize = 0;
+        }
+        applyProfile(library, &tuning);
+    }
+    if (!(flags & LIBRARY_READONLY)) {
+        createTable(library);
+    } else {
+        library->normalized = hasSchemaObject(library, "Books", "view");
+    }
+    checkDataVersion(library);
+    if ((flags & LIBRARY_ISBN_INDEX) && !loadIsbnIndex(library)) {
+        libraryClose(library);
+        return NULL;
+    }
+    return library;
+}
+
+static int checkDataVersion(LibraryDb* library) {
+    sqlite3_stmt* stmt = getStatement(library, STMT_DATA_VERSION);
+    if (stmt == NULL || sqlite3_step(stmt) != SQLITE_ROW) {
+        releaseStatement(stmt);
+        return 1; // Assume the worst
+    }
+    long long version = sqlite3_column_int64(stmt, 0);
+    releaseStatement(stmt);
+    int changed = version != library->dataVersion;
+    library->dataVersion = version;
+    return changed;
+}
+
+static void syncLibrary(LibraryDb* library) {
+    if (!checkDataVersion(library)) {
+        return;
+    }
+
+    if (library->isbnIndex != NULL && !loadIsbnIndex(library)) {
+        isbnSetFree(library->isbnIndex);
+        library->isbnIndex = NULL;
+    }
+    int normalized = hasSchemaObject(library, "Books", "view");
+    if (normalized != library->normalized) {
+        if (statementsBusy(library)) {
+            // A visitor is walking a cached statement, try again on the next write
+            library->dataVersion = 0;
+        } else {
+            clearStatementCache(library);
+            library->normalized = normalized;
+        }
+    }
+}
+
+static int statementsBusy(LibraryDb* library) {
+    for (sqlite3_stmt* stmt = sqlite3_next_stmt(library->db, NULL); stmt != NULL;
+         stmt = sqlite3_next_stmt(library->db, stmt)) {
+        if (sqlite3_stmt_busy(stmt)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int loadIsbnIndex(LibraryDb* library) {
+    // Changes committed from now on are found by syncLibrary
+    checkDataVersion(library);
+    if (library->isbnIndex == NULL) {
+        library->isbnIndex = isbnSetCreate((size_t) countBooks(library));
+        if (library->isbnIndex == NULL) {
+            return 0;
+        }
+    } else {
+        isbnSetClear(library->isbnIndex);
+    }
+
+    sqlite3_stmt* stmt = getStatement(library, STMT_SELECT_ISBNS);
+    if (stmt == NULL) {
+        fprintf(stderr, "SQL Error: %s\n", sqlite3_errmsg(library->db));
+        return 0;
+    }
+
+    int rc;
+    uint64_t key;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        // ISBNs that are not 13 digits are left to the UNIQUE constraint
+        if (isbnPack((const char*) sqlite3_column_text(stmt, 0), &key) && !isbnSetAdd(library->isbnIndex, key)) {
+            break;
+        }
+    }
+    releaseStatement(stmt);
+    if (rc != SQLITE_DONE) {
+        if (rc != SQLITE_ROW) {
+            fprintf(stderr, "Error loading ISBN index: %s\n", sqlite3_errmsg(library->db));
+        }
+        return 0;
+    }
+    return 1;
+}
+
+static int isbnIndexed(LibraryDb* library, const char* isbn) {
+    uint64_t key;
+    if (library->isbnIndex == NULL || !isbnPack(isbn, &key) || !isbnSetContains(library->isbnIndex, key)) {
+        return 0;
+    }
+    return findIsbn(library, isbn) == 1;
+}
+
+static void indexIsbn(LibraryDb* library, const char* isbn) {
+    uint64_t key;
+    if (library->isbnIndex != NULL && isbnPack(isbn, &key) && !isbnSetAdd(library->isbnIndex, key)) {
+        isbnSetFree(library->isbnIndex);
+        library->isbnIndex = NULL;
+    }
+}
+
+int libraryHasIsbn(LibraryDb* library, const char* isbn) {
+    if (library == NULL || isbn == NULL) {
+        return 0;
+    }
+
+    uint64_t key;
+    syncLibrary(library);
+    if (library->isbnIndex != NULL && isbnPack(isbn, &key) && !isbnSetContains(library->isbnIndex, key)) {
+        return 0;
+    }
+    return findIsbn(library, isbn);
+}
+
+static int findIsbn(LibraryDb* library, const char* isbn) {
+    sqlite3_stmt* stmt = getStatement(library, STMT_FIND_ISBN);
+    if (stmt == NULL) {
+        fprintf(stderr, "SQL Error: %s\n", sqlite3_errmsg(library->db));
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, isbn, -1, SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    releaseStatement(stmt);
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+        fprintf(stderr, "SQL Error: %s\n", sqlite3_errmsg(library->db));
+        return -1;
+    }
+    return rc == SQLITE_ROW;
+}
+
+ConnectionProfile connectionProfilePreset(ProfilePreset preset) {
+    ConnectionProfile profile;
+    profile.journalMode = "WAL";
+    profile.pageSize = 4096;
+    profile.tempStore = "MEMORY";
+
+    switch (preset) {
+        case PROFILE_BULK_LOAD:
+            // Large imports that can be re-run if the machine loses power
+            profile.synchronous = "OFF";
+            profile.cacheSize = -256 * 1024;
+            profile.mmapSize = 1024LL * 1024 * 1024;
+            break;
+        case PROFILE_BALANCED:
+            // A power loss may undo the last commits but never corrupts
+            profile.synchronous = "NORMAL";
+            profile.cacheSize = -64 * 1024;
+            profile.mmapSize = 256LL * 1024 * 1024;
+            break;
+        case PROFILE_DURABLE:
+        default:
+            // Every commit is on disk before it returns
+            profile.synchronous = "FULL";
+            profile.cacheSize = -16 * 1024;
+            profile.mmapSize = 0;
+            break;
+    }
+    return profile;
+}
+
+static void applyProfile(LibraryDb* library, const ConnectionProfile* profile) {
+    char pragma[128];
+
+    // The page size can only be picked before the first table is created
+    if (profile->pageSize > 0 && countPages(library) == 0) {
+        snprintf(pragma, sizeof(pragma), "PRAGMA page_size = %d", profile->pageSize);
+        execCommand(library, pragma);
+    }
+    if (profile->journalMode != NULL) {
+        // journal_mode returns the mode it switched to, so it needs sqlite3_exec
+        snprintf(pragma, sizeof(pragma), "PRAGMA journal_mode = %s", profile->journalMode);
+        execCommand(library, pragma);
+    }
+    if (profile->synchronous != NULL) {
+        snprintf(pragma, sizeof(pragma), "PRAGMA synchronous = %s", profile->synchronous);
+        execCommand(library, pragma);
+    }
+    if (profile->cacheSize != 0) {
+        snprintf(pragma, sizeof(pragma), "PRAGMA cache_size = %d", profile->cacheSize);
+        execCommand(library, pragma);
+    }
+    if (profile->mmapSize >= 0) {
+        snprintf(pragma, sizeof(pragma), "PRAGMA mmap_size = %lld", profile->mmapSize);
+        execCommand(library, pragma);
+    }
+    if (profile->tempStore != NULL) {
+        snprintf(pragma, sizeof(pragma), "PRAGMA temp_store = %s", profile->tempStore);
+        execCommand(library, pragma);
+    }
+}
+
+static int countPages(LibraryDb* library) {
+    sqlite3_stmt* stmt;
+    int pages = -1;
+    if (sqlite3_prepare_v2(library->db, "PRAGMA page_count", -1, &stmt, 0) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            pages = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    return pages;
+}
+
+static const char* statementText(const LibraryDb* library, StatementId id) {
+    return library->normalized && recordSql[id] != NULL ? recordSql[id] : statementSql[id];
+}
+
+static sqlite3_stmt* getStatement(LibraryDb* library, StatementId id) {
+    if (library->statementCache[id] != NULL) {
+        library->cacheStats.hits++;
+        return library->statementCache[id];
+    }
+
+    int rc = sqlite3_prepare_v3(library->db, statementText(library, id), -1, SQLITE_PREPARE_PERSISTENT,
+                                &library->statementCache[id], 0);
+    if (rc != SQLITE_OK) {
+        library->statementCache[id] = NULL;
+        return NULL;
+    }
+
+    library->cacheStats.prepares++;
+    return library->statementCache[id];
+}
+
+static void releaseStatement(sqlite3_stmt* stmt) {
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+}
+
+static sqlite3_stmt* getShapeStatement(LibraryDb* library, unsigned key, const char* sql) {
+    for (int i = 0; i < library->shapeCacheCount; i++) {
+        if (library->shapeCache[i].key == key) {
+            library->cacheStats.hits++;
+            return library->shapeCache[i].stmt;
+        }
+    }
+
+    if (library->shapeCacheCount == library->shapeCacheCapacity) {
+        int capacity = library->shapeCacheCapacity > 0 ? library->shapeCacheCapacity * 2 : 8;
+        ShapeStatement* grown = realloc(library->shapeCache, capacity * sizeof(ShapeStatement));
+        if (grown == NULL) {
+            return NULL;
+        }
+        library->shapeCache = grown;
+        library->shapeCacheCapacity = capacity;
+    }
+
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v3(library->db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, 0);
+    if (rc != SQLITE_OK) {
+        return NULL;
+    }
+
+    library->cacheStats.prepares++;
+    library->shapeCache[library->shapeCacheCount].key = key;
+    library->shapeCache[library->shapeCacheCount].stmt = stmt;
+    library->shapeCacheCount++;
+    return stmt;
+}
+
+static void clearStatementCache(LibraryDb* library) {
+    for (int i = 0; i < STMT_CACHE_SIZE; i++) {
+        sqlite3_finalize(library->statementCache[i]);
+        library->statementCache[i] = NULL;
+    }
+
+    for (int i = 0; i < library->shapeCacheCount; i++) {
+        sqlite3_finalize(library->shapeCache[i].stmt);
+    }
+    free(library->shapeCache);
+    library->shapeCache = NULL;
+    library->shapeCacheCount = 0;
+    library->shapeCacheCapacity = 0;
+}
+
+StatementCacheStats libraryStatementCacheStats(LibraryDb* library) {
+    StatementCacheStats empty = {0, 0};
+    return library != NULL ? library->cacheStats : empty;
+}
+
+static void createTable(LibraryDb* library) {
+    char* errorMsg = 0;
+    int rc;
+    int ready = 1;
+
+    // Set up by an earlier run, so every object below exists
+    if (schemaVersion(library) >= SCHEMA_VERSION) {
+        library->normalized = hasSchemaObject(library, "Books", "view");
+        return;
+    }
+
+    // A new library starts out normalized, an older one keeps its Books table
+    // until migrateSchema is run on it
+    if (!hasSchemaObject(library, "Books", NULL)) {
+        rc = sqlite3_exec(library->db, "BEGIN;" RECORD_TABLES_SQL BOOKS_VIEW_SQL "COMMIT;", 0, 0, &errorMsg);
+        if (rc != SQLITE_OK) {
+            // Most likely another connection created them first
+            sqlite3_free(errorMsg);
+            sqlite3_exec(library->db, "ROLLBACK", 0, 0, 0);
+        }
+    }
+    library->normalized = hasSchemaObject(library, "Books", "view");
+
+    if (!library->normalized) {
+        // Indexes for the columns books are filtered by, see getBooksWhere. They
+        // hold NumberOfPages so countBooksBy and getLibraryStats never read the
+        // table. Indexes made before NumberOfPages was added are replaced.
+        const char* sqlIndexes = "DROP INDEX IF EXISTS BooksAuthor;"
+                                "DROP INDEX IF EXISTS BooksGenre;"
+                                "DROP INDEX IF EXISTS BooksLanguage;"
+                                "CREATE INDEX IF NOT EXISTS BooksAuthorPages ON Books(Author, NumberOfPages);"
+                                "CREATE INDEX IF NOT EXISTS BooksGenrePages ON Books(Genre, NumberOfPages);"
+                                "CREATE INDEX IF NOT EXISTS BooksLanguagePages ON Books(Language, NumberOfPages);";
+        rc = sqlite3_exec(library->db, sqlIndexes, 0, 0, &errorMsg);
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "Cannot create indexes: %s\n", errorMsg);
+            sqlite3_free(errorMsg);
+            ready = 0;
+        }
+    }
+
+    // A step that failed, e.g. the search index without FTS5, is tried again
+    // on the next open
+    ready = createSearchIndex(library) && ready;
+    ready = createStatsTable(library) && ready;
+    if (ready) {
+        char sql[64];
+        snprintf(sql, sizeof(sql), "PRAGMA user_version = %d", SCHEMA_VERSION);
+        execCommand(library, sql);
+    }
+}
+
+static int schemaVersion(LibraryDb* library) {
+    sqlite3_stmt* stmt;
+    int version = 0;
+    if (sqlite3_prepare_v2(library->db, "PRAGMA user_version", -1, &stmt, 0) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            version = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    return version;
+}
+
+static int hasSchemaObject(LibraryDb* library, const char* name, const char* type) {
+    sqlite3_stmt* stmt;
+    int exists = 0;
+    if (sqlite3_prepare_v2(library->db, "SELECT 1 FROM sqlite_master WHERE name = ?1 AND (?2 IS NULL OR type = ?2)",
+                           -1, &stmt, 0) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, type, -1, SQLITE_STATIC);
+        exists = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+    }
+    return exists;
+}
+
+static int createSearchIndex(LibraryDb* library) {
+    // Nothing to do if the index was made by an earlier run
+    if (hasSchemaObject(library, "BooksSearch", NULL)) {
+        return 1;
+    }
+
+    // Index the books stored before the search index existed
+    const char* sqlStatement = library->normalized
+        ? "BEGIN;" SEARCH_TABLE_SQL RECORD_SEARCH_TRIGGERS_SQL "INSERT INTO BooksSearch(BooksSearch) VALUES ('rebuild');COMMIT;"
+        : "BEGIN;" SEARCH_TABLE_SQL BOOK_SEARCH_TRIGGERS_SQL "INSERT INTO BooksSearch(BooksSearch) VALUES ('rebuild');COMMIT;";
+
+    char* errorMsg = 0;
+    int rc = sqlite3_exec(library->db, sqlStatement, 0, 0, &errorMsg);
+    if (rc != SQLITE_OK) {
+        // Most likely sqlite was built without FTS5, local search is unavailable
+        fprintf(stderr, "Cannot create search index: %s\n", errorMsg);
+        sqlite3_free(errorMsg);
+        sqlite3_exec(library->db, "ROLLBACK", 0, 0, 0);
+    }
+    return rc == SQLITE_OK;
+}
+
+static int createStatsTable(LibraryDb* library) {
+    // Nothing to do if the table was made by an earlier run
+    if (hasSchemaObject(library, "LibraryStats", NULL)) {
+        return 1;
+    }
+
+    // Count the books stored before the table existed
+    const char* sqlStatement = library->normalized
+        ? "BEGIN;" STATS_TABLE_SQL RECORD_STATS_TRIGGERS_SQL STATS_REBUILD_SQL "COMMIT;"
+        : "BEGIN;" STATS_TABLE_SQL BOOK_STATS_TRIGGERS_SQL STATS_REBUILD_SQL "COMMIT;";
+
+    char* errorMsg = 0;
+    int rc = sqlite3_exec(library->db, sqlStatement, 0, 0, &errorMsg);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot create stats table: %s\n", errorMsg);
+        sqlite3_free(errorMsg);
+        sqlite3_exec(library->db, "ROLLBACK", 0, 0, 0);
+    }
+    return rc == SQLITE_OK;
+}
+
+int libraryRebuildStats(LibraryDb* library) {
+    if (library == NULL) {
+        return OPERATION_FAIL;
+    }
+    syncLibrary(library);
+    if (!execCommand(library, "BEGIN IMMEDIATE")) {
+        return OPERATION_FAIL;
+    }
+    if (!execCommand(library, STATS_REBUILD_SQL) || (library->normalized && !execCommand(library, PRUNE_NAMES_SQL))) {
+        execCommand(library, "ROLLBACK");
+        return OPERATION_FAIL;
+    }
+    return execCommand(library, "COMMIT");
+}
+
+int libraryMigrateSchema(LibraryDb* library, int batchSize, MigrationReport* report) {
+    MigrationReport localReport;
+    if (report == NULL) {
+        report = &localReport;
+    }
+    memset(report, 0, sizeof(MigrationReport));
+    if (library == NULL) {
+        return OPERATION_FAIL;
+    }
+    if (library->normalized) {
+        return OPERATION_SUCCESS; // Nothing to migrate
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // Make the new tables next to the Books table, along with the triggers
+    // that copy every write made to Books from now on. Running the migration
+    // again after it was stopped finds them already there
+    char* errorMsg = 0;
+    int rc = sqlite3_exec(library->db, "BEGIN IMMEDIATE;" RECORD_TABLES_SQL SYNC_TRIGGERS_SQL "COMMIT;", 0, 0, &errorMsg);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot create normalized tables: %s\n", errorMsg);
+        sqlite3_free(errorMsg);
+        sqlite3_exec(library->db, "ROLLBACK", 0, 0, 0);
+        return OPERATION_FAIL;
+    }
+
+    if (!copyBookRecords(library, batchSize > 0 ? batchSize : (int) library->batchCommitSize, report) ||
+        !replaceBooksTable(library)) {
+        return OPERATION_FAIL;
+    }
+
+    // Every cached statement was prepared for the Books table
+    clearStatementCache(library);
+    library->normalized = 1;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    report->seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    return OPERATION_SUCCESS;
+}
+
+static int copyBookRecords(LibraryDb* library, int batchSize, MigrationReport* report) {
+    sqlite3_stmt* range = NULL;
+    sqlite3_stmt* batch[MIGRATE_BATCH_STATEMENTS] = {NULL};
+    int ok = sqlite3_prepare_v2(library->db, "SELECT MAX(BookID) FROM "
+                                "(SELECT BookID FROM Books WHERE BookID > ? ORDER BY BookID LIMIT ?)",
+                                -1, &range, 0) == SQLITE_OK;
+    for (size_t i = 0; ok && i < MIGRATE_BATCH_STATEMENTS; i++) {
+        ok = sqlite3_prepare_v2(library->db, migrateBatchSql[i], -1, &batch[i], 0) == SQLITE_OK;
+    }
+
+    // Walks Books in BookID order. Rows copied by an earlier run, or by the
+    // sync triggers, are skipped by OR IGNORE
+    int64_t lastId = INT64_MIN;
+    while (ok) {
+        sqlite3_bind_int64(range, 1, lastId);
+        sqlite3_bind_int(range, 2, batchSize);
+        ok = sqlite3_step(range) == SQLITE_ROW;
+        int done = ok && sqlite3_column_type(range, 0) == SQLITE_NULL;
+        int64_t endId = ok ? sqlite3_column_int64(range, 0) : 0;
+        sqlite3_reset(range);
+        if (!ok || done) {
+            break;
+        }
+
+        if (!execCommand(library, "BEGIN IMMEDIATE")) {
+            ok = 0;
+            break;
+        }
+        for (size_t i = 0; ok && i < MIGRATE_BATCH_STATEMENTS; i++) {
+            sqlite3_bind_int64(batch[i], 1, lastId);
+            sqlite3_bind_int64(batch[i], 2, endId);
+            ok = sqlite3_step(batch[i]) == SQLITE_DONE;
+            sqlite3_reset(batch[i]);
+        }
+        // The last statement copies the books
+        long copied = sqlite3_changes(library->db);
+        if (!ok || !execCommand(library, "COMMIT")) {
+            ok = 0;
+            break;
+        }
+        report->books += copied;
+        report->batches++;
+        lastId = endId;
+
+        // Leave the write lock free for a moment so writers on other
+        // connections are not starved while the books are copied
+        sqlite3_sleep(MIGRATE_PAUSE_MS);
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Error migrating books: %s\n", sqlite3_errmsg(library->db));
+        if (!sqlite3_get_autocommit(library->db)) {
+            execCommand(library, "ROLLBACK");
+        }
+    }
+    sqlite3_finalize(range);
+    for (size_t i = 0; i < MIGRATE_BATCH_STATEMENTS; i++) {
+        sqlite3_finalize(batch[i]);
+    }
+    return ok;
+}
+
+static int replaceBooksTable(LibraryDb* library) {
+    if (!execCommand(library, "BEGIN IMMEDIATE")) {
+        return 0;
+    }
+
+    // With the write lock held no book can change, so if the counts match
+    // every book was copied and kept up to date
+    sqlite3_stmt* stmt;
+    int matches = 0;
+    if (sqlite3_prepare_v2(library->db, "SELECT (SELECT COUNT(*) FROM Books) = (SELECT COUNT(*) FROM BookRecords)",
+                           -1, &stmt, 0) == SQLITE_OK) {
+        matches = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    if (!matches) {
+        fprintf(stderr, "Error migrating books: BookRecords does not match Books\n");
+        execCommand(library, "ROLLBACK");
+        return 0;
+    }
+
+    // Dropping Books also drops its indexes and triggers. BooksSearch and
+    // LibraryStats hold the same rows and values as before, so they only
+    // need their triggers moved to BookRecords
+    int hasSearch = hasSchemaObject(library, "BooksSearch", NULL);
+    int hasStats = hasSchemaObject(library, "LibraryStats", NULL);
+    char* errorMsg = 0;
+    int rc = sqlite3_exec(library->db, "DROP TABLE Books;" BOOKS_VIEW_SQL, 0, 0, &errorMsg);
+    if (rc == SQLITE_OK && hasSearch) {
+        rc = sqlite3_exec(library->db, RECORD_SEARCH_TRIGGERS_SQL, 0, 0, &errorMsg);
+    }
+    if (rc == SQLITE_OK && hasStats) {
+        rc = sqlite3_exec(library->db, RECORD_STATS_TRIGGERS_SQL, 0, 0, &errorMsg);
+    }
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot replace the Books table: %s\n", errorMsg);
+        sqlite3_free(errorMsg);
+        execCommand(library, "ROLLBACK");
+        return 0;
+    }
+    return execCommand(library, "COMMIT");
+}
+
+int libraryAddBook(LibraryDb* library, BookData data) {
+    return libraryAddBookWithId(library, data, NULL);
+}
+
+int libraryAddBookWithId(LibraryDb* library, BookData data, int64_t* id) {
+    int rc = 0;
+    if (library == NULL) {
+        return OPERATION_FAIL;
+    }
+    syncLibrary(library);
+    if (isbnIndexed(library, data.ISBN)) {
+        fprintf(stderr, "A book with the ISBN %s already exists\n", data.ISBN);
+        return OPERATION_FAIL;
+    }
+    if (!beginBookWrite(library)) {
+        return OPERATION_FAIL;
+    }
+    if (!storeNames(library, &data, BOOK_FIELD_ALL)) {
+        endBookWrite(library, 0);
+        return OPERATION_FAIL;
+    }
+
+    // Get the cached insert statement
+    sqlite3_stmt* stmt = getStatement(library, STMT_INSERT_BOOK);
+    if (stmt == NULL) {
+        fprintf(stderr, "SQL Error When Inserting Data: %s\n", sqlite3_errmsg(library->db));
+        endBookWrite(library, 0);
+        return OPERATION_FAIL;
+    }
+
+    // Bind values to sql statement
+    bindBook(stmt, &data);
+
+    // Execute insert
+    rc = sqlite3_step(stmt);
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "SQL Error When Executing INSERT: %s\n", sqlite3_errmsg(library->db));
+        releaseStatement(stmt);
+        endBookWrite(library, 0);
+        return OPERATION_FAIL;
+    }
+
+    int64_t rowId = sqlite3_last_insert_rowid(library->db);
+    releaseStatement(stmt);
+    if (!endBookWrite(library, 1)) {
+        return OPERATION_FAIL;
+    }
+    if (id != NULL) {
+        *id = rowId;
+    }
+    indexIsbn(library, data.ISBN);
+    return OPERATION_SUCCESS;
+}
+
+int libraryUpsertBook(LibraryDb* library, BookData data, UpsertPolicy policy) {
+    if (library == NULL) {
+        return OPERATION_FAIL;
+    }
+
+    StatementId id = policy == UPSERT_FILL_MISSING ? STMT_UPSERT_FILL_MISSING
+                   : policy == UPSERT_KEEP_EXISTING ? STMT_UPSERT_KEEP_EXISTING
+                   : STMT_UPSERT_MERGE;
+    syncLibrary(library);
+
+    // Overwriting a stored book may leave its old names without books
+    int64_t oldNames[4] = {0, 0, 0, 0};
+    if (library->normalized && policy != UPSERT_KEEP_EXISTING && data.ISBN != NULL) {
+        sqlite3_stmt* stmt = getStatement(library, STMT_NAME_IDS_BY_ISBN);
+        if (stmt != NULL) {
+            sqlite3_bind_text(stmt, 1, data.ISBN, -1, SQLITE_STATIC);
+        }
+        storedNameIds(stmt, oldNames);
+    }
+
+    if (!beginBookWrite(library)) {
+        return OPERATION_FAIL;
+    }
+    if (!storeNames(library, &data, BOOK_FIELD_ALL)) {
+        endBookWrite(library, 0);
+        return OPERATION_FAIL;
+    }
+    sqlite3_stmt* stmt = getStatement(library, id);
+    if (stmt == NULL) {
+        fprintf(stderr, "SQL Error When Upserting Data: %s\n", sqlite3_errmsg(library->db));
+        endBookWrite(library, 0);
+        return OPERATION_FAIL;
+    }
+
+    bindBook(stmt, &data);
+    int rc = sqlite3_step(stmt);
+    releaseStatement(stmt);
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "SQL Error When Executing UPSERT: %s\n", sqlite3_errmsg(library->db));
+        endBookWrite(library, 0);
+        return OPERATION_FAIL;
+    }
+    NameIdList oldList = {&oldNames, 1, 1, 0};
+    pruneNames(library, &oldList);
+    if (!endBookWrite(library, 1)) {
+        return OPERATION_FAIL;
+    }
+
+    indexIsbn(library, data.ISBN);
+    return OPERATION_SUCCESS;
+}
+
+long libraryDeleteBooksByIds(LibraryDb* library, const int64_t* ids, size_t count) {
+    if (library == NULL || (ids == NULL && count > 0)) {
+        return -1;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    syncLibrary(library);
+
+    // Created once, as creating a table makes every prepared statement re-prepare
+    if (!library->deleteIdsReady) {
+        if (!execCommand(library, "CREATE TEMP TABLE IF NOT EXISTS DeleteIds (BookID INTEGER PRIMARY KEY)")) {
+            return -1;
+        }
+        library->deleteIdsReady = 1;
+    }
+
+    // Join a transaction the caller has open, else make one
+    int ownTransaction = sqlite3_get_autocommit(library->db);
+    if (ownTransaction && !execCommand(library, "BEGIN IMMEDIATE")) {
+        return -1;
+    }
+
+    long deleted = -1;
+    sqlite3_stmt* insert = getStatement(library, STMT_INSERT_DELETE_ID);
+    sqlite3_stmt* remove = getStatement(library, STMT_DELETE_LISTED);
+    sqlite3_stmt* clear = getStatement(library, STMT_CLEAR_DELETE_IDS);
+    if (insert != NULL && remove != NULL && clear != NULL) {
+        size_t i = 0;
+        for (; i < count; i++) {
+            sqlite3_bind_int64(insert, 1, ids[i]);
+            int rc = sqlite3_step(insert);
+            releaseStatement(insert);
+            if (rc != SQLITE_DONE) {
+                break;
+            }
+        }
+        if (i == count) {
+            deleted = runDelete(library, remove);
+        }
+
+        int rc = sqlite3_step(clear);
+        releaseStatement(clear);
+        if (rc != SQLITE_DONE) {
+            deleted = -1;
+        }
+    }
+
+    if (deleted < 0) {
+        fprintf(stderr, "SQL Error When Executing DELETE: %s\n", sqlite3_errmsg(library->db));
+    }
+    if (ownTransaction) {
+        if (deleted >= 0 && !libraryCommit(library)) {
+            deleted = -1;
+        }
+        if (deleted < 0) {
+            libraryRollback(library);
+        }
+    }
+    return deleted;
+}
+
+long libraryDeleteBooksWhere(LibraryDb* library, const BookFilter* filter) {
+    unsigned shape = filterShape(filter);
+    if (library == NULL || shape == 0) {
+        return -1;
+    }
+    syncLibrary(library);
+
+    // A view cannot be deleted from with RETURNING, so a normalized library
+    // finds the books through the view and deletes them from BookRecords
+    char sql[128 + FILTER_SQL_SIZE];
+    if (library->normalized) {
+        strcpy(sql, "DELETE FROM BookRecords WHERE BookID IN (SELECT BookID FROM Books");
+        appendFilterWhere(sql, shape);
+        strcat(sql, ") RETURNING ISBN, " RECORD_NAME_IDS);
+    } else {
+        strcpy(sql, "DELETE FROM Books");
+        appendFilterWhere(sql, shape);
+        strcat(sql, " RETURNING ISBN");
+    }
+
+    sqlite3_stmt* stmt = getShapeStatement(library, SHAPE_DELETE_WHERE | shape, sql);
+    if (stmt == NULL) {
+        fprintf(stderr, "SQL Error When Deleting Data: %s\n", sqlite3_errmsg(library->db));
+        return -1;
+    }
+
+    bindFilter(stmt, filter, 1);
+    long deleted = runDelete(library, stmt);
+    if (deleted < 0) {
+        fprintf(stderr, "SQL Error When Executing DELETE: %s\n", sqlite3_errmsg(library->db));
+    }
+    return deleted;
+}
+
+static long runDelete(LibraryDb* library, sqlite3_stmt* stmt) {
+    NameIdList removed = {NULL, 0, 0, 0};
+    long deleted = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        uint64_t key;
+        if (library->isbnIndex != NULL && isbnPack((const char*) sqlite3_column_text(stmt, 0), &key)) {
+            isbnSetRemove(library->isbnIndex, key);
+        }
+        if (library->normalized) {
+            int64_t nameIds[4];
+            readNameIds(stmt, 1, nameIds);
+            addNameIds(&removed, nameIds);
+        }
+        deleted++;
+    }
+    releaseStatement(stmt);
+    if (rc == SQLITE_DONE && library->normalized) {
+        pruneNames(library, &removed);
+    }
+    freeNameIds(&removed);
+    if (rc != SQLITE_DONE) {
+        // The statement was undone, put back the ISBNs taken out of the index
+        if (library->isbnIndex != NULL && !loadIsbnIndex(library)) {
+            isbnSetFree(library->isbnIndex);
+            library->isbnIndex = NULL;
+        }
+        return -1;
+    }
+    return deleted;
+}
+
+int libraryUpdateBook(LibraryDb* library, int64_t id, const BookData* changes, uint32_t fieldMask) {
+    fieldMask &= BOOK_FIELD_ALL;
+    if (library == NULL || changes == NULL || fieldMask == 0 || id < 1) {
+        return OPERATION_FAIL;
+    }
+
+    syncLibrary(library);
+
+    // Keep the ISBN index right when the ISBN changes
+    char oldIsbn[14] = "";
+    int isbnChanges = (fieldMask & BOOK_FIELD_ISBN) && library->isbnIndex != NULL;
+    if (isbnChanges) {
+        if (!storedIsbn(library, id, oldIsbn)) {
+            return OPERATION_FAIL;
+        }
+        if (strcmp(oldIsbn, changes->ISBN != NULL ? changes->ISBN : "") != 0 &&
+            isbnIndexed(library, changes->ISBN)) {
+            fprintf(stderr, "A book with the ISBN %s already exists\n", changes->ISBN);
+            return OPERATION_FAIL;
+        }
+    }
+
+    // Changing a name may leave the old one without books
+    int64_t oldNames[4] = {0, 0, 0, 0};
+    if (library->normalized && (fieldMask & NAME_FIELDS)) {
+        sqlite3_stmt* stmt = getStatement(library, STMT_NAME_IDS_BY_ID);
+        if (stmt != NULL) {
+            sqlite3_bind_int64(stmt, 1, id);
+        }
+        storedNameIds(stmt, oldNames);
+    }
+
+    if (!beginBookWrite(library)) {
+        return OPERATION_FAIL;
+    }
+    if (!storeNames(library, changes, fieldMask)) {
+        endBookWrite(library, 0);
+        return OPERATION_FAIL;
+    }
+
+    char sql[UPDATE_SQL_SIZE];
+    strcpy(sql, library->normalized ? "UPDATE BookRecords SET " : "UPDATE Books SET ");
+    for (int i = 0, first = 1; i < BOOK_TEXT_FIELDS + 1; i++) {
+        if (fieldMask & (1u << i)) {
+            strcat(sql, first ? "" : ", ");
+            if (library->normalized) {
+                strcat(sql, recordSetters[i]);
+            } else {
+                strcat(sql, fieldColumns[i]);
+                strcat(sql, " = ?");
+            }
+            first = 0;
+        }
+    }
+    // The updated row is counted from RETURNING, as sqlite3_changes does not
+    // count rows changed by the trigger of a view
+    strcat(sql, " WHERE BookID = ? RETURNING BookID");
+
+    sqlite3_stmt* stmt = getShapeStatement(library, SHAPE_UPDATE | fieldMask, sql);
+    if (stmt == NULL) {
+        fprintf(stderr, "SQL Error When Updating Data: %s\n", sqlite3_errmsg(library->db));
+        endBookWrite(library, 0);
+        return OPERATION_FAIL;
+    }
+
+    const char* text[BOOK_TEXT_FIELDS] = {
+        changes->title, changes->author, changes->publisher, changes->publicationDate,
+        changes->ISBN, changes->genre, changes->lang
+    };
+    int index = 1;
+    for (int i = 0; i < BOOK_TEXT_FIELDS; i++) {
+        if (fieldMask & (1u << i)) {
+            sqlite3_bind_text(stmt, index++, text[i], -1, SQLITE_STATIC);
+        }
+    }
+    if (fieldMask & BOOK_FIELD_NUM_PAGES) {
+        sqlite3_bind_int(stmt, index++, changes->numPages);
+    }
+    sqlite3_bind_int64(stmt, index, id);
+
+    int updated = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        updated++;
+    }
+    releaseStatement(stmt);
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "SQL Error When Executing UPDATE: %s\n", sqlite3_errmsg(library->db));
+        endBookWrite(library, 0);
+        return OPERATION_FAIL;
+    }
+    if (updated > 0) {
+        NameIdList oldList = {&oldNames, 1, 1, 0};
+        pruneNames(library, &oldList);
+    }
+    // No book has the id when nothing was updated
+    if (!endBookWrite(library, updated > 0)) {
+        return OPERATION_FAIL;
+    }
+
+    if (isbnChanges) {
+        uint64_t key;
+        if (isbnPack(oldIsbn, &key)) {
+            isbnSetRemove(library->isbnIndex, key);
+        }
+        indexIsbn(library, changes->ISBN);
+    }
+    return OPERATION_SUCCESS;
+}
+
+int libraryRenameFieldValue(LibraryDb* library, uint32_t field, const char* from, const char* to) {
+    if (library == NULL || from == NULL || to == NULL ||
+        (field != BOOK_FIELD_AUTHOR && field != BOOK_FIELD_PUBLISHER && field != BOOK_FIELD_GENRE &&
+         field != BOOK_FIELD_LANG)) {
+        return OPERATION_FAIL;
+    }
+
+    syncLibrary(library);
+    const char* column = field == BOOK_FIELD_AUTHOR ? "Author" : field == BOOK_FIELD_PUBLISHER ? "Publisher"
+                       : field == BOOK_FIELD_GENRE ? "Genre" : "Language";
+    char sql[96];
+    // A normalized library renames the one row of the name table. When the new
+    // name is already stored, the books are moved to it like in a library that
+    // is not normalized, which rewrites each book that has the old name
+    for (int moveBooks = !library->normalized; moveBooks < 2; moveBooks++) {
+        if (moveBooks) {
+            snprintf(sql, sizeof(sql), "UPDATE Books SET %s = ?1 WHERE %s = ?2", column, column);
+        } else {
+            snprintf(sql, sizeof(sql), "UPDATE %ss SET Name = ?1 WHERE Name = ?2", column);
+        }
+
+        sqlite3_stmt* stmt = getShapeStatement(library, SHAPE_RENAME | (moveBooks << 8) | field, sql);
+        if (stmt == NULL) {
+            fprintf(stderr, "SQL Error When Renaming: %s\n", sqlite3_errmsg(library->db));
+            return OPERATION_FAIL;
+        }
+        sqlite3_bind_text(stmt, 1, to, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, from, -1, SQLITE_STATIC);
+        int rc = sqlite3_step(stmt);
+        int error = sqlite3_extended_errcode(library->db);
+        releaseStatement(stmt);
+        if (rc == SQLITE_DONE) {
+            if (moveBooks && library->normalized) {
+                pruneName(library, field, column, from);
+            }
+            return OPERATION_SUCCESS;
+        }
+        if (moveBooks || error != SQLITE_CONSTRAINT_UNIQUE) {
+            fprintf(stderr, "SQL Error When Executing UPDATE: %s\n", sqlite3_errstr(error));
+            return OPERATION_FAIL;
+        }
+    }
+    return OPERATION_FAIL;
+}
+
+static int storedIsbn(LibraryDb* library, int64_t id, char* isbn) {
+    sqlite3_stmt* stmt = getStatement(library, STMT_SELECT_ISBN_BY_ID);
+    if (stmt == NULL) {
+        fprintf(stderr, "SQL Error: %s\n", sqlite3_errmsg(library->db));
+        return 0;
+    }
+
+    sqlite3_bind_int64(stmt, 1, id);
+    int found = sqlite3_step(stmt) == SQLITE_ROW;
+    const char* stored = found ? (const char*) sqlite3_column_text(stmt, 0) : NULL;
+    isbn[0] = '\0';
+    if (stored != NULL && strlen(stored) == 13) {
+        memcpy(isbn, stored, 14);
+    }
+    releaseStatement(stmt);
+    return found;
+}
+
+static void bindBook(sqlite3_stmt* stmt, const BookData* data) {
+    sqlite3_bind_text(stmt, 1, data->title, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, data->author, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, data->publisher, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 4, data->publicationDate, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 5, data->ISBN, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 6, data->genre, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 7, data->lang, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 8, data->numPages);
+}
+
+static int storeNames(LibraryDb* library, const BookData* data, uint32_t fieldMask) {
+    if (!library->normalized) {
+        return 1;
+    }
+
+    const uint32_t fields[4] = {BOOK_FIELD_AUTHOR, BOOK_FIELD_PUBLISHER, BOOK_FIELD_GENRE, BOOK_FIELD_LANG};
+    const StatementId ids[4] = {STMT_STORE_AUTHOR, STMT_STORE_PUBLISHER, STMT_STORE_GENRE, STMT_STORE_LANGUAGE};
+    const char* names[4] = {data->author, data->publisher, data->genre, data->lang};
+    for (int i = 0; i < 4; i++) {
+        if (!(fieldMask & fields[i]) || names[i] == NULL) {
+            continue;
+        }
+
+        sqlite3_stmt* stmt = getStatement(library, ids[i]);
+        if (stmt == NULL) {
+            fprintf(stderr, "SQL Error: %s\n", sqlite3_errmsg(library->db));
+            return 0;
+        }
+        sqlite3_bind_text(stmt, 1, names[i], -1, SQLITE_STATIC);
+        int rc = sqlite3_step(stmt);
+        releaseStatement(stmt);
+        if (rc != SQLITE_DONE) {
+            fprintf(stderr, "SQL Error When Storing Names: %s\n", sqlite3_errmsg(library->db));
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int beginBookWrite(LibraryDb* library) {
+    if (library->normalized && stepStatement(library, STMT_SAVEPOINT) != SQLITE_DONE) {
+        fprintf(stderr, "SQL Error: %s\n", sqlite3_errmsg(library->db));
+        return 0;
+    }
+    return 1;
+}
+
+static int endBookWrite(LibraryDb* library, int succeeded) {
+    if (!library->normalized) {
+        return succeeded;
+    }
+    if (!succeeded) {
+        // Fails harmlessly if an error already rolled the transaction back
+        stepStatement(library, STMT_ROLLBACK_SAVEPOINT);
+    }
+    if (stepStatement(library, STMT_RELEASE_SAVEPOINT) != SQLITE_DONE && !sqlite3_get_autocommit(library->db)) {
+        // Releasing the outermost savepoint commits, when that fails undo the write
+        fprintf(stderr, "SQL Error: %s\n", sqlite3_errmsg(library->db));
+        stepStatement(library, STMT_ROLLBACK_SAVEPOINT);
+        stepStatement(library, STMT_RELEASE_SAVEPOINT);
+        return 0;
+    }
+    return succeeded;
+}
+
+static int stepStatement(LibraryDb* library, StatementId id) {
+    sqlite3_stmt* stmt = getStatement(library, id);
+    if (stmt == NULL) {
+        return SQLITE_ERROR;
+    }
+    int rc = sqlite3_step(stmt);
+    releaseStatement(stmt);
+    return rc;
+}
+
+static void readNameIds(sqlite3_stmt* stmt, int column, int64_t nameIds[4]) {
+    for (int i = 0; i < 4; i++) {
+        nameIds[i] = sqlite3_column_int64(stmt, column + i);
+    }
+}
+
+static void storedNameIds(sqlite3_stmt* stmt, int64_t nameIds[4]) {
+    memset(nameIds, 0, 4 * sizeof(int64_t));
+    if (stmt != NULL && sqlite3_step(stmt) == SQLITE_ROW) {
+        readNameIds(stmt, 0, nameIds);
+    }
+    if (stmt != NULL) {
+        releaseStatement(stmt);
+    }
+}
+
+static void addNameIds(NameIdList* list, const int64_t nameIds[4]) {
+    if (list->overflowed) {
+        return;
+    }
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity > 0 ? list->capacity * 2 : MIN_BOOK_CAPACITY;
+        int64_t (*grown)[4] = realloc(list->rows, capacity * sizeof(*grown));
+        if (grown == NULL) {
+            list->overflowed = 1;
+            return;
+        }
+        list->rows = grown;
+        list->capacity = capacity;
+    }
+    memcpy(list->rows[list->count++], nameIds, sizeof(list->rows[0]));
+}
+
+static void freeNameIds(NameIdList* list) {
+    free(list->rows);
+    memset(list, 0, sizeof(NameIdList));
+}
+
+static void pruneNames(LibraryDb* library, const NameIdList* list) {
+    if (list->overflowed) {
+        // Some ids were not kept, so look at every name
+        execCommand(library, PRUNE_NAMES_SQL);
+        return;
+    }
+    if (list->count == 0) {
+        return;
+    }
+
+    // Each table's ids go to its statement as one JSON array, e.g. [3,17]
+    char* json = malloc(list->count * 21 + 3);
+    if (json == NULL) {
+        fprintf(stderr, "Error Allocating Memory in pruneNames\n");
+        return;
+    }
+    const StatementId ids[4] = {STMT_PRUNE_AUTHOR, STMT_PRUNE_PUBLISHER, STMT_PRUNE_GENRE, STMT_PRUNE_LANGUAGE};
+    for (int i = 0; i < 4; i++) {
+        size_t length = 0;
+        json[length++] = '[';
+        for (size_t row = 0; row < list->count; row++) {
+            if (list->rows[row][i] != 0) {
+                length += sprintf(json + length, "%s%lld", length > 1 ? "," : "", (long long) list->rows[row][i]);
+            }
+        }
+        if (length == 1) {
+            continue;
+        }
+        json[length++] = ']';
+        json[length] = '\0';
+
+        sqlite3_stmt* stmt = getStatement(library, ids[i]);
+        int rc = SQLITE_ERROR;
+        if (stmt != NULL) {
+            sqlite3_bind_text(stmt, 1, json, (int) length, SQLITE_STATIC);
+            rc = sqlite3_step(stmt);
+            releaseStatement(stmt);
+        }
+        if (rc != SQLITE_DONE) {
+            fprintf(stderr, "SQL Error When Removing Names: %s\n", sqlite3_errmsg(library->db));
+        }
+    }
+    free(json);
+}
+
+static void pruneName(LibraryDb* library, uint32_t field, const char* column, const char* name) {
+    char sql[160];
+    snprintf(sql, sizeof(sql), "DELETE FROM %ss WHERE Name = ?1 AND NOT EXISTS "
+             "(SELECT 1 FROM BookRecords WHERE %sID = %ss.%sID)", column, column, column, column);
+    sqlite3_stmt* stmt = getShapeStatement(library, SHAPE_RENAME | (2 << 8) | field, sql);
+    int rc = SQLITE_ERROR;
+    if (stmt != NULL) {
+        sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+        rc = sqlite3_step(stmt);
+        releaseStatement(stmt);
+    }
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "SQL Error When Removing Names: %s\n", sqlite3_errmsg(library->db));
+    }
+}
+
+static int execCommand(LibraryDb* library, const char* sql) {
+    char* errorMsg = 0;
+    int rc = sqlite3_exec(library->db, sql, 0, 0, &errorMsg);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "SQL Error When Executing %s: %s\n", sql, errorMsg);
+        sqlite3_free(errorMsg);
+        return OPERATION_FAIL;
+    }
+    return OPERATION_SUCCESS;
+}
+
+int libraryBeginWrite(LibraryDb* library) {
+    return library != NULL ? execCommand(library, "BEGIN IMMEDIATE") : OPERATION_FAIL;
+}
+
+int libraryCommit(LibraryDb* library) {
+    return library != NULL ? execCommand(library, "COMMIT") : OPERATION_FAIL;
+}
+
+int libraryRollback(LibraryDb* library) {
+    if (library == NULL || !execCommand(library, "ROLLBACK")) {
+        return OPERATION_FAIL;
+    }
+    // The index may hold ISBNs of rows that were just undone
+    if (library->isbnIndex != NULL && !loadIsbnIndex(library)) {
+        isbnSetFree(library->isbnIndex);
+        library->isbnIndex = NULL;
+    }
+    return OPERATION_SUCCESS;
+}
+
+int libraryInTransaction(LibraryDb* library) {
+    return library != NULL && !sqlite3_get_autocommit(library->db);
+}
+
+void librarySetBatchCommitSize(LibraryDb* library, size_t rows) {
+    if (library == NULL) {
+        return;
+    }
+    library->batchCommitSize = rows > 0 ? rows : DEFAULT_BATCH_COMMIT_SIZE;
+}
+
+long libraryAddBooks(LibraryDb* library, const BookData* books, size_t numBooks, InsertStatus* statuses) {
+    if (library == NULL || (books == NULL && numBooks > 0)) {
+        return -1;
+    }
+
+    // Names stored for books that were then not inserted, removed once per chunk
+    NameIdList unused = {NULL, 0, 0, 0};
+    long inserted = 0;
+    size_t i = 0;
+    while (i < numBooks) {
+        // Each chunk is committed on its own so a large batch keeps bounded journal size
+        size_t chunkEnd = i + library->batchCommitSize < numBooks ? i + library->batchCommitSize : numBooks;
+        size_t chunkStart = i;
+        long chunkInserted = 0;
+
+        if (!execCommand(library, "BEGIN IMMEDIATE")) {
+            break;
+        }
+        // Other connections cannot commit while the transaction holds the write
+        // lock. Fetched after syncLibrary, which may clear the statement cache
+        syncLibrary(library);
+        sqlite3_stmt* stmt = getStatement(library, STMT_INSERT_BOOK);
+        if (stmt == NULL) {
+            fprintf(stderr, "SQL Error When Inserting Data: %s\n", sqlite3_errmsg(library->db));
+            libraryRollback(library);
+            break;
+        }
+
+        for (; i < chunkEnd; i++) {
+            if (isbnIndexed(library, books[i].ISBN)) {
+                if (statuses != NULL) {
+                    statuses[i] = INSERT_DUPLICATE;
+                }
+                continue;
+            }
+
+            InsertStatus status = INSERT_OK;
+            int rc = SQLITE_DONE;
+            if (storeNames(library, &books[i], BOOK_FIELD_ALL)) {
+                bindBook(stmt, &books[i]);
+                rc = sqlite3_step(stmt);
+            } else {
+                status = INSERT_ERROR;
+            }
+
+            if (rc != SQLITE_DONE) {
+                // A constraint failure only undoes this row, the transaction stays open
+                switch (sqlite3_extended_errcode(library->db)) {
+                    case SQLITE_CONSTRAINT_UNIQUE:
+                        status = INSERT_DUPLICATE;
+                        break;
+                    case SQLITE_CONSTRAINT_CHECK:
+                    case SQLITE_CONSTRAINT_NOTNULL:
+                        status = INSERT_INVALID;
+                        break;
+                    default:
+                        status = INSERT_ERROR;
+                        break;
+                }
+            }
+            releaseStatement(stmt);
+            if (library->normalized && (status == INSERT_DUPLICATE || status == INSERT_INVALID)) {
+                int64_t nameIds[4];
+                sqlite3_stmt* names = getStatement(library, STMT_NAME_IDS_BY_NAMES);
+                if (names != NULL) {
+                    sqlite3_bind_text(names, 1, books[i].author, -1, SQLITE_STATIC);
+                    sqlite3_bind_text(names, 2, books[i].publisher, -1, SQLITE_STATIC);
+                    sqlite3_bind_text(names, 3, books[i].genre, -1, SQLITE_STATIC);
+                    sqlite3_bind_text(names, 4, books[i].lang, -1, SQLITE_STATIC);
+                }
+                storedNameIds(names, nameIds);
+                addNameIds(&unused, nameIds);
+            }
+
+            if (statuses != NULL) {
+                statuses[i] = status;
+            }
+            if (status == INSERT_ERROR) {
+                break;
+            }
+            if (status == INSERT_OK) {
+                chunkInserted++;
+                indexIsbn(library, books[i].ISBN);
+            }
+        }
+
+        if (i == chunkEnd && library->normalized) {
+            pruneNames(library, &unused);
+        }
+        unused.count = 0;
+        unused.overflowed = 0;
+
+        if (i < chunkEnd) {
+            // Any other error leaves the transaction unusable, undo this chunk
+            fprintf(stderr, "SQL Error When Executing INSERT: %s\n", sqlite3_errmsg(library->db));
+            libraryRollback(library);
+            i = chunkStart;
+            break;
+        }
+
+        if (!execCommand(library, "COMMIT")) {
+            libraryRollback(library);
+            i = chunkStart;
+            break;
+        }
+        inserted += chunkInserted;
+    }
+
+    freeNameIds(&unused);
+
+    if (i < numBooks) {
+        // Rows that were rolled back or never attempted
+        if (statuses != NULL) {
+            for (; i < numBooks; i++) {
+                statuses[i] = INSERT_ERROR;
+            }
+        }
+        return -1;
+    }
+    return inserted;
+}
+
+int libraryDeleteBookById(LibraryDb* library, int id) {
+    if (library == NULL || id < 1) {
+        return OPERATION_FAIL;
+    }
+
+    syncLibrary(library);
+    sqlite3_stmt* stmt = getStatement(library, STMT_DELETE_BOOK);
+    if (stmt == NULL) {
+        fprintf(stderr, "SQL Error When Deleting Data: %s\n", sqlite3_errmsg(library->db));
+        return OPERATION_FAIL;
+    }
+
+    // Bind id and execute sql, the deleted ISBN comes back as a row
+    sqlite3_bind_int(stmt, 1, id);
+    if (runDelete(library, stmt) < 0) {
+        fprintf(stderr, "SQL Error When Executing DELETE: %s\n", sqlite3_errmsg(library->db));
+        return OPERATION_FAIL;
+    }
+    return OPERATION_SUCCESS;
+}
+
+BookArray libraryGetBooks(LibraryDb* library) {
+    BookArray result = {NULL, 0, NULL, 0};
+    if (library == NULL || !loadBooks(library, &result, 0)) {
+        free(result.books);
+        result.books = NULL;
+        result.count = -1;
+        result.capacity = 0;
+    }
+    return result;
+}
+
+BookArray libraryGetBooksArena(LibraryDb* library) {
+    BookArray result = {NULL, 0, NULL, 0};
+    if (library == NULL) {
+        result.count = -1;
+        return result;
+    }
+
+    result.arena = calloc(1, sizeof(BookArena));
+    if (result.arena == NULL) {
+        fprintf(stderr, "Error Allocating Memory in getBooksArena\n");
+        result.count = -1;
+        return result;
+    }
+
+    if (!loadBooks(library, &result, 0)) {
+        free(result.books);
+        freeArena(result.arena);
+        result.books = NULL;
+        result.count = -1;
+        result.arena = NULL;
+        result.capacity = 0;
+    }
+    return result;
+}
+
+int libraryReloadBooks(LibraryDb* library, BookArray* array, int presize) {
+    if (library == NULL || array == NULL) {
+        return OPERATION_FAIL;
+    }
+    return loadBooks(library, array, presize);
+}
+
+static int loadBooks(LibraryDb* library, BookArray* array, int presize) {
+    // Drop the previous rows but keep the pointer array and arena chunks
+    clearRows(array);
+
+    if (presize) {
+        int rows = countBooks(library);
+        if (rows > array->capacity && !growBooks(array, rows)) {
+            return OPERATION_FAIL;
+        }
+    }
+
+    sqlite3_stmt* stmt = getStatement(library, STMT_SELECT_BOOKS);
+    if (stmt == NULL) {
+        fprintf(stderr, "SQL Error: %s\n", sqlite3_errmsg(library->db));
+        return OPERATION_FAIL;
+    }
+    return readRows(library, array, stmt, BOOK_FIELD_ALL);
+}
+
+int libraryGetBooksPage(LibraryDb* library, int64_t afterId, int limit, BookArray* out) {
+    return loadPage(library, STMT_SELECT_PAGE_AFTER, afterId, limit, out);
+}
+
+int libraryGetBooksPageBefore(LibraryDb* library, int64_t beforeId, int limit, BookArray* out) {
+    if (!loadPage(library, STMT_SELECT_PAGE_BEFORE, beforeId, limit, out)) {
+        return OPERATION_FAIL;
+    }
+
+    // The page was read newest first, flip it back into BookID order
+    for (int i = 0, j = out->count - 1; i < j; i++, j--) {
+        BookData* swap = out->books[i];
+        out->books[i] = out->books[j];
+        out->books[j] = swap;
+    }
+    return OPERATION_SUCCESS;
+}
+
+int librarySearchBooks(LibraryDb* library, const char* query, int limit, BookArray* out) {
+    if (library == NULL || query == NULL || out == NULL || limit < 1) {
+        return OPERATION_FAIL;
+    }
+
+    clearRows(out);
+    char* matchQuery = buildMatchQuery(query);
+    if (matchQuery == NULL) {
+        return OPERATION_SUCCESS; // Nothing to search for, no books match
+    }
+
+    sqlite3_stmt* stmt = getStatement(library, STMT_SEARCH_BOOKS);
+    if (stmt == NULL) {
+        fprintf(stderr, "SQL Error When Searching: %s\n", sqlite3_errmsg(library->db));
+        free(matchQuery);
+        return OPERATION_FAIL;
+    }
+
+    sqlite3_bind_text(stmt, 1, matchQuery, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, limit);
+    int result = readRows(library, out, stmt, BOOK_FIELD_ALL);
+    free(matchQuery);
+    return result;
+}
+
+int libraryGetBooksWhere(LibraryDb* library, const BookFilter* filter, BookArray* out) {
+    return libraryGetBooksWhereFields(library, filter, BOOK_FIELD_ALL, out);
+}
+
+int libraryGetBooksWhereFields(LibraryDb* library, const BookFilter* filter, uint32_t fields, BookArray* out) {
+    if (library == NULL || out == NULL) {
+        return OPERATION_FAIL;
+    }
+
+    clearRows(out);
+    fields &= BOOK_FIELD_ALL;
+    char sql[SELECT_SQL_SIZE + FILTER_SQL_SIZE + 32];
+    sqlite3_stmt* stmt = getSelectWhere(library, filterShape(filter), fields, sql);
+    if (stmt == NULL) {
+        fprintf(stderr, "SQL Error: %s\n", sqlite3_errmsg(library->db));
+        return OPERATION_FAIL;
+    }
+
+    bindFilter(stmt, filter, 1);
+    return readRows(library, out, stmt, fields);
+}
+
+int libraryForEachBook(LibraryDb* library, BookVisitor fn, void* context, const BookFilter* filter) {
+    return libraryForEachBookFields(library, fn, context, filter, BOOK_FIELD_ALL);
+}
+
+int libraryForEachBookFields(LibraryDb* library, BookVisitor fn, void* context, const BookFilter* filter, uint32_t fields) {
+    if (library == NULL || fn == NULL) {
+        return OPERATION_FAIL;
+    }
+
+    // Shares the statement of getBooksWhereFields, as the SQL is the same
+    fields &= BOOK_FIELD_ALL;
+    char sql[SELECT_SQL_SIZE + FILTER_SQL_SIZE + 32];
+    sqlite3_stmt* stmt = getSelectWhere(library, filterShape(filter), fields, sql);
+    int ownsStatement = 0;
+    if (stmt != NULL && sqlite3_stmt_busy(stmt)) {
+        // A visitor further up the stack is walking it, use a private one
+        if (sqlite3_prepare_v2(library->db, sql, -1, &stmt, 0) != SQLITE_OK) {
+            stmt = NULL;
+        }
+        ownsStatement = 1;
+    }
+    if (stmt == NULL) {
+        fprintf(stderr, "SQL Error: %s\n", sqlite3_errmsg(library->db));
+        return OPERATION_FAIL;
+    }
+
+    bindFilter(stmt, filter, 1);
+    BookView view;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        readView(stmt, &view, fields);
+        if (fn(context, &view) == 0) {
+            rc = SQLITE_DONE;
+            break;
+        }
+    }
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "Error In forEachBook(): %s\n", sqlite3_errmsg(library->db));
+    }
+
+    if (ownsStatement) {
+        sqlite3_finalize(stmt);
+    } else {
+        releaseStatement(stmt);
+    }
+    return rc == SQLITE_DONE ? OPERATION_SUCCESS : OPERATION_FAIL;
+}
+
+static sqlite3_stmt* getSelectWhere(LibraryDb* library, unsigned shape, uint32_t fields, char* sql) {
+    appendSelectFields(sql, fields);
+    appendFilterWhere(sql, shape);
+    strcat(sql, " ORDER BY BookID");
+    return getShapeStatement(library, SHAPE_SELECT_WHERE | (fields << FILTER_SHAPE_BITS) | shape, sql);
+}
+
+static void appendSelectFields(char* sql, uint32_t fields) {
+    strcpy(sql, "SELECT BookID");
+    for (int i = 0; i < BOOK_TEXT_FIELDS + 1; i++) {
+        if (fields & (1u << i)) {
+            strcat(sql, ", ");
+            strcat(sql, fieldColumns[i]);
+        }
+    }
+    strcat(sql, " FROM Books");
+}
+
+int libraryGetLibraryStats(LibraryDb* library, LibraryStats* out) {
+    if (library == NULL || out == NULL) {
+        return OPERATION_FAIL;
+    }
+
+    sqlite3_stmt* stmt = getStatement(library, STMT_LIBRARY_STATS);
+    if (stmt == NULL) {
+        fprintf(stderr, "SQL Error: %s\n", sqlite3_errmsg(library->db));
+        return OPERATION_FAIL;
+    }
+
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        out->books = (long) sqlite3_column_int64(stmt, 0);
+        out->totalPages = sqlite3_column_int64(stmt, 1);
+        out->authors = (long) sqlite3_column_int64(stmt, 2);
+        out->genres = (long) sqlite3_column_int64(stmt, 3);
+        out->languages = (long) sqlite3_column_int64(stmt, 4);
+    } else {
+        fprintf(stderr, "Error In getLibraryStats(): %s\n", sqlite3_errmsg(library->db));
+    }
+    releaseStatement(stmt);
+    return rc == SQLITE_ROW ? OPERATION_SUCCESS : OPERATION_FAIL;
+}
+
+int libraryCountBooksBy(LibraryDb* library, uint32_t field, BookGroupVisitor fn, void* context) {
+    if (library == NULL || fn == NULL ||
+        (field != BOOK_FIELD_AUTHOR && field != BOOK_FIELD_GENRE && field != BOOK_FIELD_LANG)) {
+        return OPERATION_FAIL;
+    }
+
+    // The counters are kept by the LibraryStats triggers, see createStatsTable
+    sqlite3_stmt* stmt = getStatement(library, STMT_COUNT_BY);
+    if (stmt == NULL || sqlite3_stmt_busy(stmt)) {
+        fprintf(stderr, "SQL Error: %s\n", stmt == NULL ? sqlite3_errmsg(library->db) : "countBooksBy is already running");
+        return OPERATION_FAIL;
+    }
+    const char* kind = field == BOOK_FIELD_AUTHOR ? "author" : field == BOOK_FIELD_GENRE ? "genre" : "language";
+    sqlite3_bind_text(stmt, 1, kind, -1, SQLITE_STATIC);
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (fn(context, (const char*) sqlite3_column_text(stmt, 0), (long) sqlite3_column_int64(stmt, 1),
+               (long long) sqlite3_column_int64(stmt, 2)) == 0) {
+            rc = SQLITE_DONE;
+            break;
+        }
+    }
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "Error In countBooksBy(): %s\n", sqlite3_errmsg(library->db));
+    }
+    releaseStatement(stmt);
+    return rc == SQLITE_DONE ? OPERATION_SUCCESS : OPERATION_FAIL;
+}
+
+static unsigned filterShape(const BookFilter* filter) {
+    unsigned shape = 0;
+    if (filter != NULL) {
+        if (filter->author != NULL) shape |= FILTER_AUTHOR;
+        if (filter->genre != NULL) shape |= FILTER_GENRE;
+        if (filter->lang != NULL) shape |= FILTER_LANG;
+    }
+    return shape;
+}
+
+static void appendFilterWhere(char* sql, unsigned shape) {
+    const char* joiner = " WHERE ";
+    if (shape & FILTER_AUTHOR) {
+        strcat(sql, joiner);
+        strcat(sql, "Author = ?");
+        joiner = " AND ";
+    }
+    if (shape & FILTER_GENRE) {
+        strcat(sql, joiner);
+        strcat(sql, "Genre = ?");
+        joiner = " AND ";
+    }
+    if (shape & FILTER_LANG) {
+        strcat(sql, joiner);
+        strcat(sql, "Language = ?");
+    }
+}
+
+static int bindFilter(sqlite3_stmt* stmt, const BookFilter* filter, int index) {
+    if (filter == NULL) {
+        return index;
+    }
+    if (filter->author != NULL) {
+        sqlite3_bind_text(stmt, index++, filter->author, -1, SQLITE_STATIC);
+    }
+    if (filter->genre != NULL) {
+        sqlite3_bind_text(stmt, index++, filter->genre, -1, SQLITE_STATIC);
+    }
+    if (filter->lang != NULL) {
+        sqlite3_bind_text(stmt, index++, filter->lang, -1, SQLITE_STATIC);
+    }
+    return index;
+}
+
+static char* buildMatchQuery(const char* text) {
+    // Worst case every character is a quote that gets doubled, plus quotes,
+    // spaces and the prefix star around each word
+    size_t length = strlen(text);
+    char* query = malloc(length * 4 + 4);
+    if (query == NULL) {
+        fprintf(stderr, "Error Allocating Memory in searchLocalBooks\n");
+        return NULL;
+    }
+
+    size_t pos = 0;
+    const char* c = text;
+    while (*c != '\0') {
+        while (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r') {
+            c++;
+        }
+        if (*c == '\0') {
+            break;
+        }
+
+        if (pos > 0) {
+            query[pos++] = ' ';
+        }
+        query[pos++] = '"';
+        while (*c != '\0' && *c != ' ' && *c != '\t' && *c != '\n' && *c != '\r') {
+            if (*c == '"') {
+                query[pos++] = '"';
+            }
+            query[pos++] = *c++;
+        }
+        query[pos++] = '"';
+    }
+
+    if (pos == 0) {
+        free(query);
+        return NULL;
+    }
+    query[pos++] = '*';
+    query[pos] = '\0';
+    return query;
+}
+
+static int loadPage(LibraryDb* library, StatementId id, int64_t boundaryId, int limit, BookArray* out) {
+    if (library == NULL || out == NULL || limit < 1) {
+        return OPERATION_FAIL;
+    }
+
+    // The limit is only an upper bound, so a huge limit must not size the array
+    clearRows(out);
+    int presize = limit < PAGE_PRESIZE ? limit : PAGE_PRESIZE;
+    if (presize > out->capacity && !growBooks(out, presize)) {
+        return OPERATION_FAIL;
+    }
+
+    sqlite3_stmt* stmt = getStatement(library, id);
+    if (stmt == NULL) {
+        fprintf(stderr, "SQL Error: %s\n", sqlite3_errmsg(library->db));
+        return OPERATION_FAIL;
+    }
+    sqlite3_bind_int64(stmt, 1, boundaryId);
+    sqlite3_bind_int(stmt, 2, limit);
+    return readRows(library, out, stmt, BOOK_FIELD_ALL);
+}
+
+static int readRows(LibraryDb* library, BookArray* array, sqlite3_stmt* stmt, uint32_t fields) {
+    int rc = 0;
+    BookArena* arena = array->arena;
+
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (array->count == array->capacity && !growBooks(array, array->count + 1)) {
+            break;
+        }
+
+        // Arena rows are packed next to each other inside the row chunks
+        BookData* book = arena != NULL ? arenaAlloc(arena, &arena->rows, sizeof(BookData))
+                                       : calloc(1, sizeof(BookData));
+        if (book == NULL) {
+            fprintf(stderr, "Error Allocating Memory in getBooks for books of count\n");
+            break;
+        }
+        array->books[array->count++] = book; // Count this row so it is freed if copying a field fails
 
-int makeConnection(void) {
-    if (db != NULL) {
-        // Only need to create connection once
-        return OPERATION_SUCCESS;
+        // Get book data from database and allocate memory for each field. The
+        // columns after BookID are the fields in the mask, in BookData order
+        char** text[BOOK_TEXT_FIELDS] = {
+            &book->title, &book->author, &book->publisher, &book->publicationDate,
+            &book->ISBN, &book->genre, &book->lang
+        };
+        int column = 1;
+        int copied = 1;
+        for (int i = 0; i < BOOK_TEXT_FIELDS; i++) {
+            *text[i] = NULL;
+        }
+        for (int i = 0; i < BOOK_TEXT_FIELDS && copied; i++) {
+            if (fields & (1u << i)) {
+                const unsigned char* src = sqlite3_column_text(stmt, column++);
+                copied = arena != NULL && (INTERNED_FIELDS & (1u << i)) ? internField(text[i], src, arena)
+                                                                        : copyField(text[i], src, arena);
+            }
+        }
+        if (!copied) {
+            fprintf(stderr, "Memory Allocation Error: %s\n", sqlite3_errmsg(library->db));
+            break;
+        }
+
+        book->numPages = fields & BOOK_FIELD_NUM_PAGES ? sqlite3_column_int(stmt, column) : 0;
+        book->id = sqlite3_column_int64(stmt, 0);
     }
-    
-    // Open a db connection and check to make sure it worked
-    int rc = sqlite3_open("data/library.db", &db);
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "Cannot open database: %s\n", sqlite3_errmsg(db));
-        sqlite3_close(db);
+
+    releaseStatement(stmt);
+    if (rc != SQLITE_DONE) {
+        if (rc != SQLITE_ROW) {
+            fprintf(stderr, "Error In getBooks(): %s\n", sqlite3_errmsg(library->db));
+        }
+        clearRows(array);
         return OPERATION_FAIL;
     }
-
-    createTable();
     return OPERATION_SUCCESS;
 }
 
-static void createTable(void) {
-    char* errorMsg = 0;
-    char* sqlStatement = "CREATE TABLE Books ("
-                        "BookID INTEGER PRIMARY KEY,"
-                        "Title TEXT NOT NULL,"
-                        "Author TEXT NOT NULL,"
-                        "Publisher TEXT,"
-                        "PublicationDate TEXT,"
-                        "ISBN TEXT UNIQUE CHECK (LENGTH(ISBN) = 13),"
-                        "Genre TEXT,"
-                        "Language TEXT,"
-                        "NumberOfPages INTEGER"
-                        ");";
-
-    int rc = sqlite3_exec(db, sqlStatement, 0, 0, &errorMsg);
-    if (rc != SQLITE_OK) {
-        // Table is already created
-        sqlite3_free(errorMsg);
+static int countBooks(LibraryDb* library) {
+    sqlite3_stmt* stmt = getStatement(library, STMT_COUNT_BOOKS);
+    if (stmt == NULL) {
+        return 0;
+    }
+
+    int rows = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        rows = sqlite3_column_int(stmt, 0);
+    }
+    releaseStatement(stmt);
+    return rows;
+}
+
+static int growBooks(BookArray* array, int minCapacity) {
+    // Double the capacity so filling n rows costs O(n) copying in total
+    int capacity = array->capacity > 0 ? array->capacity * 2 : MIN_BOOK_CAPACITY;
+    if (capacity < minCapacity) {
+        capacity = minCapacity;
+    }
+
+    BookData** grown = realloc(array->books, capacity * sizeof(BookData *));
+    if (grown == NULL) {
+        fprintf(stderr, "Error Allocating Memory in getBooks for books\n");
+        return 0;
+    }
+    array->books = grown;
+    array->capacity = capacity;
+    return 1;
+}
+
+static void clearRows(BookArray* array) {
+    if (array->arena != NULL) {
+        resetArena(array->arena);
+    } else {
+        for (int i = 0; i < array->count; i++) {
+            freeBook(array->books[i]);
+        }
+    }
+    array->count = 0;
+}
+
+BookCursor* libraryOpenBooks(LibraryDb* library) {
+    if (library == NULL) {
+        return NULL;
+    }
+
+    BookCursor* cursor = calloc(1, sizeof(BookCursor));
+    if (cursor == NULL) {
+        fprintf(stderr, "Error Allocating Memory in openBooks\n");
+        return NULL;
+    }
+
+    cursor->stmt = getStatement(library, STMT_SELECT_BOOKS);
+    if (cursor->stmt != NULL && sqlite3_stmt_busy(cursor->stmt)) {
+        // Another cursor is walking the cached statement, use a private one
+        cursor->stmt = NULL;
+        if (sqlite3_prepare_v2(library->db, statementText(library, STMT_SELECT_BOOKS), -1, &cursor->stmt, 0) == SQLITE_OK) {
+            cursor->ownsStatement = 1;
+        } else {
+            cursor->stmt = NULL;
+        }
+    }
+
+    if (cursor->stmt == NULL) {
+        fprintf(stderr, "SQL Error: %s\n", sqlite3_errmsg(library->db));
+        free(cursor);
+        return NULL;
+    }
+    return cursor;
+}
+
+int nextBook(BookCursor* cursor, BookData* out) {
+    if (cursor == NULL || out == NULL) {
+        return CURSOR_ERROR;
+    }
+
+    int rc = sqlite3_step(cursor->stmt);
+    if (rc == SQLITE_DONE) {
+        return CURSOR_DONE;
+    }
+    if (rc != SQLITE_ROW) {
+        fprintf(stderr, "Error In nextBook(): %s\n", sqlite3_errmsg(sqlite3_db_handle(cursor->stmt)));
+        return CURSOR_ERROR;
+    }
+
+    if (!copyCursorField(cursor, 0, 1, &out->title) ||
+        !copyCursorField(cursor, 1, 2, &out->author) ||
+        !copyCursorField(cursor, 2, 3, &out->publisher) ||
+        !copyCursorField(cursor, 3, 4, &out->publicationDate) ||
+        !copyCursorField(cursor, 4, 5, &out->ISBN) ||
+        !copyCursorField(cursor, 5, 6, &out->genre) ||
+        !copyCursorField(cursor, 6, 7, &out->lang)) {
+        return CURSOR_ERROR;
+    }
+    out->numPages = sqlite3_column_int(cursor->stmt, 8);
+    out->id = sqlite3_column_int64(cursor->stmt, 0);
+    return CURSOR_ROW;
+}
+
+int nextBookView(BookCursor* cursor, BookView* out) {
+    if (cursor == NULL || out == NULL) {
+        return CURSOR_ERROR;
+    }
+
+    int rc = sqlite3_step(cursor->stmt);
+    if (rc == SQLITE_DONE) {
+        return CURSOR_DONE;
+    }
+    if (rc != SQLITE_ROW) {
+        fprintf(stderr, "Error In nextBookView(): %s\n", sqlite3_errmsg(sqlite3_db_handle(cursor->stmt)));
+        return CURSOR_ERROR;
+    }
+
+    readView(cursor->stmt, out, BOOK_FIELD_ALL);
+    return CURSOR_ROW;
+}
+
+static void readView(sqlite3_stmt* stmt, BookView* view, uint32_t fields) {
+    // Borrow sqlite's buffers, which stay put until the statement steps again
+    const char** text[BOOK_TEXT_FIELDS] = {
+        &view->title, &view->author, &view->publisher, &view->publicationDate,
+        &view->ISBN, &view->genre, &view->lang
+    };
+    int column = 1;
+    for (int i = 0; i < BOOK_TEXT_FIELDS; i++) {
+        *text[i] = fields & (1u << i) ? (const char*) sqlite3_column_text(stmt, column++) : NULL;
+    }
+    view->numPages = fields & BOOK_FIELD_NUM_PAGES ? sqlite3_column_int(stmt, column) : 0;
+    view->id = sqlite3_column_int64(stmt, 0);
+}
+
+void closeBooks(BookCursor* cursor) {
+    if (cursor == NULL) {
         return;
     }
+
+    if (cursor->ownsStatement) {
+        sqlite3_finalize(cursor->stmt);
+    } else {
+        releaseStatement(cursor->stmt);
+    }
+    for (int i = 0; i < BOOK_TEXT_FIELDS; i++) {
+        free(cursor->buffers[i]);
+    }
+    free(cursor);
 }
 
-int addBook(BookData data) {
-    int rc = 0;
-    const char* sqlInsert = "INSERT INTO Books (Title, Author, Publisher, PublicationDate, ISBN, Genre, Language, NumberOfPages) "
-                            "VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
+static int copyCursorField(BookCursor* cursor, int field, int column, char** dest) {
+    const unsigned char* src = sqlite3_column_text(cursor->stmt, column);
+    if (src == NULL) {
+        *dest = NULL;
+        return 1;
+    }
 
-    // Prepare sql statement
-    sqlite3_stmt* stmt;
-    rc = sqlite3_prepare_v2(db, sqlInsert, -1, &stmt, 0);
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "SQL Error When Inserting Data: %s\n", sqlite3_errmsg(db));
-        return OPERATION_FAIL;
+    size_t size = (size_t) sqlite3_column_bytes(cursor->stmt, column) + 1; // Plus one for null-terminator
+    if (size > cursor->capacities[field]) {
+        char* grown = realloc(cursor->buffers[field], size);
+        if (grown == NULL) {
+            fprintf(stderr, "Error Allocating Memory in nextBook\n");
+            return 0;
+        }
+        cursor->buffers[field] = grown;
+        cursor->capacities[field] = size;
     }
 
-    // Bind values to sql statement
-    sqlite3_bind_text(stmt, 1, data.title, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, data.author, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 3, data.publisher, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 4, data.publicationDate, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 5, data.ISBN, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 6, data.genre, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt,7, data.lang, -1, SQLITE_STATIC);
-    sqlite3_bind_int64(stmt, 8, data.numPages);
+    memcpy(cursor->buffers[field], src, size);
+    *dest = cursor->buffers[field];
+    return 1;
+}
 
-    // Execute insert
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_DONE) {
-        fprintf(stderr, "SQL Error When Executing INSERT: %s\n", sqlite3_errmsg(db));
-        return OPERATION_FAIL;
+static int copyField(char** dest, const unsigned char* src, BookArena* arena) {
+    if (src == NULL) {
+        *dest = NULL;
+        return 1;
     }
 
-    // TODO store id in some sort of structure. First construct structure
-    sqlite3_int64 lastRowID = sqlite3_last_insert_rowid(db);
-    sqlite3_finalize(stmt);
-    return OPERATION_SUCCESS;
+    size_t size = strlen((const char*) src) + 1; // Plus one for null-terminator
+    *dest = arena != NULL ? arenaAlloc(arena, &arena->strings, size) : malloc(size);
+    if (*dest == NULL) {
+        fprintf(stderr, "Error Allocating Memory in getBooks\n");
+        return 0; // Return failure
+    }
+    // Copies database data into field
+    memcpy(*dest, src, size);
+    return 1; // Return success
 }
 
-int deleteBookById(int id) {
-    if (id < 1) {
+static int internField(char** dest, const unsigned char* src, BookArena* arena) {
+    if (src == NULL) {
+        *dest = NULL;
+        return 1;
+    }
+    if ((arena->internCount + 1) * 2 > arena->internCapacity &&
+        !resizeInternTable(arena, arena->internCapacity > 0 ? arena->internCapacity * 2 : MIN_INTERN_CAPACITY)) {
+        return 0;
+    }
+
+    // FNV-1a, which also finds the length on the way
+    uint32_t hash = 2166136261u;
+    size_t length = 0;
+    for (; src[length] != '\0'; length++) {
+        hash = (hash ^ src[length]) * 16777619u;
+    }
+
+    arena->internStats.lookups++;
+    size_t mask = arena->internCapacity - 1;
+    size_t slot = hash & mask;
+    for (; arena->interned[slot].text != NULL; slot = (slot + 1) & mask) {
+        InternSlot* entry = &arena->interned[slot];
+        if (entry->hash == hash && entry->length == length && memcmp(entry->text, src, length) == 0) {
+            arena->internStats.hits++;
+            // Count the aligned size the arena would have given the copy
+            arena->internStats.bytesSaved += (length + ARENA_ALIGNMENT) & ~(size_t) (ARENA_ALIGNMENT - 1);
+            *dest = (char*) entry->text;
+            return 1;
+        }
+    }
+
+    if (!copyField(dest, src, arena)) {
+        return 0;
+    }
+    arena->interned[slot] = (InternSlot) {*dest, hash, (uint32_t) length};
+    arena->internCount++;
+    return 1;
+}
+
+static int resizeInternTable(BookArena* arena, size_t capacity) {
+    InternSlot* slots = calloc(capacity, sizeof(InternSlot));
+    if (slots == NULL) {
+        fprintf(stderr, "Error Allocating Memory in getBooks\n");
+        return 0;
+    }
+
+    size_t mask = capacity - 1;
+    for (size_t i = 0; i < arena->internCapacity; i++) {
+        InternSlot entry = arena->interned[i];
+        if (entry.text != NULL) {
+            size_t slot = entry.hash & mask;
+            while (slots[slot].text != NULL) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = entry;
+        }
+    }
+    free(arena->interned);
+    arena->interned = slots;
+    arena->internCapacity = capacity;
+    return 1;
+}
+
+static void* arenaAlloc(BookArena* arena, ArenaChunk** head, size_t size) {
+    // Keep every allocation aligned for the BookData structs
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t) (ARENA_ALIGNMENT - 1);
+
+    ArenaChunk* chunk = *head;
+    if (chunk == NULL || chunk->size - chunk->used < size) {
+        if (arena->spare != NULL && size <= ARENA_CHUNK_SIZE) {
+            // Reuse a chunk kept from before the last reset
+            chunk = arena->spare;
+            arena->spare = chunk->next;
+        } else {
+            size_t chunkSize = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+            chunk = malloc(sizeof(ArenaChunk) + chunkSize);
+            if (chunk == NULL) {
+                return NULL;
+            }
+            chunk->size = chunkSize;
+        }
+        chunk->next = *head;
+        chunk->used = 0;
+        *head = chunk;
+    }
+
+    void* block = chunk->data + chunk->used;
+    chunk->used += size;
+    return block;
+}
+
+static void freeChunks(ArenaChunk* chunk) {
+    while (chunk != NULL) {
+        ArenaChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+}
+
+static void resetArena(BookArena* arena) {
+    ArenaChunk* lists[2] = {arena->rows, arena->strings};
+    for (int i = 0; i < 2; i++) {
+        ArenaChunk* chunk = lists[i];
+        while (chunk != NULL) {
+            ArenaChunk* next = chunk->next;
+            if (chunk->size == ARENA_CHUNK_SIZE) {
+                chunk->next = arena->spare;
+                arena->spare = chunk;
+            } else {
+                free(chunk); // Oversized chunks are not worth keeping
+            }
+            chunk = next;
+        }
+    }
+    arena->rows = NULL;
+    arena->strings = NULL;
+
+    // The interned strings were in the released chunks, the table itself is kept
+    if (arena->interned != NULL) {
+        memset(arena->interned, 0, arena->internCapacity * sizeof(InternSlot));
+    }
+    arena->internCount = 0;
+    memset(&arena->internStats, 0, sizeof(InternStats));
+}
+
+static void freeArena(BookArena* arena) {
+    freeChunks(arena->rows);
+    freeChunks(arena->strings);
+    freeChunks(arena->spare);
+    free(arena->interned);
+    free(arena);
+}
+
+int libraryGetBookColumns(LibraryDb* library, const BookFilter* filter, BookColumns* out) {
+    if (library == NULL || out == NULL) {
         return OPERATION_FAIL;
     }
 
-    int rc = 0;
-    sqlite3_stmt* stmt;
-    const char* sqlDelete = "DELETE FROM Books WHERE BookID = ?";
+    BookColumn* text[BOOK_TEXT_FIELDS] = {
+        &out->title, &out->author, &out->publisher, &out->publicationDate,
+        &out->ISBN, &out->genre, &out->lang
+    };
+    out->count = 0;
+    for (int i = 0; i < BOOK_TEXT_FIELDS; i++) {
+        text[i]->size = 0;
+    }
 
-    rc = sqlite3_prepare_v2(db, sqlDelete, -1, &stmt, 0);
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "SQL Error When Deleting Data: %s\n", sqlite3_errmsg(db));
+    // Without a filter every book is read, so size the arrays once up front
+    unsigned shape = filterShape(filter);
+    if (shape == 0) {
+        int total = countBooks(library);
+        if (total > out->capacity && !growColumns(out, total)) {
+            return OPERATION_FAIL;
+        }
+    }
+
+    char sql[SELECT_SQL_SIZE + FILTER_SQL_SIZE + 32];
+    sqlite3_stmt* stmt = getSelectWhere(library, shape, BOOK_FIELD_ALL, sql);
+    if (stmt == NULL) {
+        fprintf(stderr, "SQL Error: %s\n", sqlite3_errmsg(library->db));
         return OPERATION_FAIL;
     }
+    bindFilter(stmt, filter, 1);
 
-    // Bind id and execute sql
-    sqlite3_bind_int(stmt, 1, id);
-    rc = sqlite3_step(stmt);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        int row = out->count;
+        if (row == out->capacity && !growColumns(out, row + 1)) {
+            break;
+        }
+
+        int copied = 1;
+        for (int i = 0; i < BOOK_TEXT_FIELDS && copied; i++) {
+            const unsigned char* value = sqlite3_column_text(stmt, i + 1);
+            copied = appendColumnText(text[i], row, value, (size_t) sqlite3_column_bytes(stmt, i + 1));
+        }
+        if (!copied) {
+            break;
+        }
+        out->ids[row] = sqlite3_column_int64(stmt, 0);
+        out->numPages[row] = sqlite3_column_int(stmt, 8);
+        out->count++;
+    }
+
+    releaseStatement(stmt);
     if (rc != SQLITE_DONE) {
-        fprintf(stderr, "SQL Error When Executing DELETE: %s\n", sqlite3_errmsg(db));
+        if (rc != SQLITE_ROW) {
+            fprintf(stderr, "Error In getBookColumns(): %s\n", sqlite3_errmsg(library->db));
+        }
+        out->count = 0;
         return OPERATION_FAIL;
     }
-
-    sqlite3_finalize(stmt);
     return OPERATION_SUCCESS;
 }
 
-BookArray getBooks(void) {
-    int rc = 0;
-    sqlite3_stmt* stmt;
-    const char* sqlSelect = "SELECT * FROM Books";
-
-    // Return this error result if error
-    BookArray errorResult;
-    errorResult.books = NULL;
-    errorResult.count = -1;
+static int growColumns(BookColumns* columns, int minCapacity) {
+    int capacity = columns->capacity > 0 ? columns->capacity : MIN_BOOK_CAPACITY;
+    while (capacity < minCapacity) {
+        capacity *= 2;
+    }
 
-    BookData** books = NULL;
-    rc = sqlite3_prepare_v2(db, sqlSelect, -1, &stmt, 0);
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "SQL Error: %s\n", sqlite3_errmsg(db));
-        return errorResult;
+    int64_t* ids = realloc(columns->ids, capacity * sizeof(int64_t));
+    if (ids != NULL) {
+        columns->ids = ids;
+    }
+    int32_t* numPages = ids != NULL ? realloc(columns->numPages, capacity * sizeof(int32_t)) : NULL;
+    if (numPages != NULL) {
+        columns->numPages = numPages;
+    }
+    if (numPages == NULL) {
+        fprintf(stderr, "Error Allocating Memory in getBookColumns\n");
+        return 0;
     }
 
-    int rowCount = 0;
-    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
-        books = realloc(books, (rowCount + 1) * sizeof(BookData *));
-        if (books == NULL) {
-            fprintf(stderr, "Error Allocating Memory in getBooks for books\n");
-            return errorResult;
+    BookColumn* text[BOOK_TEXT_FIELDS] = {
+        &columns->title, &columns->author, &columns->publisher, &columns->publicationDate,
+        &columns->ISBN, &columns->genre, &columns->lang
+    };
+    for (int i = 0; i < BOOK_TEXT_FIELDS; i++) {
+        // One more offset than books, for the end of the last book
+        uint32_t* offsets = realloc(text[i]->offsets, (capacity + 1) * sizeof(uint32_t));
+        if (offsets == NULL) {
+            fprintf(stderr, "Error Allocating Memory in getBookColumns\n");
+            return 0;
         }
-
-        books[rowCount] = malloc(sizeof(BookData));
-        if (books[rowCount] == NULL) {
-            fprintf(stderr, "Error Allocating Memory in getBooks for books of count\n");
-            freeBooks(books, rowCount);
-            return errorResult;
+        if (text[i]->offsets == NULL) {
+            offsets[0] = 0;
         }
+        text[i]->offsets = offsets;
+    }
+    columns->capacity = capacity;
+    return 1;
+}
+
+static int appendColumnText(BookColumn* column, int row, const unsigned char* text, size_t length) {
+    if (row == 0) {
+        column->offsets[0] = 0;
+    }
+    if (text == NULL) {
+        column->offsets[row + 1] = (uint32_t) column->size;
+        return 1;
+    }
 
-        // Get book data from database and allocate memory for each field
-        if (!copyField(&(books[rowCount]->title), sqlite3_column_text(stmt, 1)) ||
-            !copyField(&(books[rowCount]->author), sqlite3_column_text(stmt, 2)) ||
-            !copyField(&(books[rowCount]->publisher), sqlite3_column_text(stmt, 3)) ||
-            !copyField(&(books[rowCount]->publicationDate), sqlite3_column_text(stmt, 4)) ||
-            !copyField(&(books[rowCount]->ISBN), sqlite3_column_text(stmt, 5)) ||
-            !copyField(&(books[rowCount]->genre), sqlite3_column_text(stmt, 6)) ||
-            !copyField(&(books[rowCount]->lang), sqlite3_column_text(stmt, 7))) {
-            fprintf(stderr, "Memory Allocation Error: %s\n", sqlite3_errmsg(db));
-            freeBooks(books, rowCount + 1); // rowCount plus one for including this row
-            return errorResult;
+    size_t needed = column->size + length + 1; // Plus one for null-terminator
+    if (needed > UINT32_MAX) {
+        fprintf(stderr, "Column too large in getBookColumns\n");
+        return 0;
+    }
+    if (needed > column->capacity) {
+        size_t capacity = column->capacity > 0 ? column->capacity : ARENA_CHUNK_SIZE;
+        while (capacity < needed) {
+            capacity *= 2;
         }
+        char* grown = realloc(column->data, capacity);
+        if (grown == NULL) {
+            fprintf(stderr, "Error Allocating Memory in getBookColumns\n");
+            return 0;
+        }
+        column->data = grown;
+        column->capacity = capacity;
+    }
+
+    memcpy(column->data + column->size, text, length + 1);
+    column->size = needed;
+    column->offsets[row + 1] = (uint32_t) needed;
+    return 1;
+}
+
+const char* bookColumnText(const BookColumn* column, int row) {
+    uint32_t start = column->offsets[row];
+    return column->offsets[row + 1] != start ? column->data + start : NULL;
+}
 
-        books[rowCount]->numPages = sqlite3_column_int(stmt, 8);
-        
-        rowCount++;
+void freeBookColumns(BookColumns* columns) {
+    if (columns == NULL) {
+        return;
     }
 
-    if (rc != SQLITE_DONE) {
-        fprintf(stderr, "Error In getBooks(): %s\n", sqlite3_errmsg(db));
-        freeBooks(books, rowCount);
-        return errorResult;
+    BookColumn* text[BOOK_TEXT_FIELDS] = {
+        &columns->title, &columns->author, &columns->publisher, &columns->publicationDate,
+        &columns->ISBN, &columns->genre, &columns->lang
+    };
+    for (int i = 0; i < BOOK_TEXT_FIELDS; i++) {
+        free(text[i]->offsets);
+        free(text[i]->data);
     }
+    free(columns->ids);
+    free(columns->numPages);
+    memset(columns, 0, sizeof(BookColumns));
+}
 
-    sqlite3_finalize(stmt);
-    BookArray result;
-    result.books = books;
-    result.count = rowCount;
-    return result;
+void freeBookArray(BookArray* array) {
+    if (array == NULL) {
+        return;
+    }
+
+    if (array->arena != NULL) {
+        free(array->books);
+        freeArena(array->arena);
+    } else {
+        freeBooks(array->books, array->count);
+    }
+    array->books = NULL;
+    array->count = 0;
+    array->arena = NULL;
+    array->capacity = 0;
 }
 
-static int copyField(char** dest, const char* src) {
-    *dest = malloc(strlen(src) + 1); // Plus one for null-terminator
-    if (*dest == NULL) {
-        fprintf(stderr, "Error Allocating Memory in getBooks\n");
-        return 0; // Return failure
+InternStats getBookArrayInternStats(const BookArray* array) {
+    InternStats stats = {0, 0, 0};
+    if (array != NULL && array->arena != NULL) {
+        stats = array->arena->internStats;
     }
-    // Copies database data into field
-    strcpy(*dest, src);
-    return 1; // Return success
+    return stats;
+}
+
+static void freeBook(BookData* book) {
+    free(book->title);
+    free(book->author);
+    free(book->publisher);
+    free(book->publicationDate);
+    free(book->ISBN);
+    free(book->genre);
+    free(book->lang);
+    free(book);
 }
 
 void freeBooks(BookData** books, int numBooks) {
     for (int i = 0; i < numBooks; i++) {
-        free(books[i]->title);
-        free(books[i]->author);
-        free(books[i]->publisher);
-        free(books[i]->publicationDate);
-        free(books[i]->ISBN);
-        free(books[i]->genre);
-        free(books[i]->lang);
-        free(books[i]);
+        freeBook(books[i]);
     }
     free(books);
 }
 
 
-int closeConnection(void) {
-    if (db == NULL) {
+int libraryClose(LibraryDb* library) {
+    if (library == NULL) {
         return OPERATION_FAIL;
     }
 
-    int rc = sqlite3_close(db);
+    // Statements must be finalized before the connection can close
+    clearStatementCache(library);
+
+    int rc = sqlite3_close(library->db);
     if (rc != SQLITE_OK) {
-        fprintf(stderr, "Error deallocating database: %s\n", sqlite3_errmsg(db));
+        fprintf(stderr, "Error deallocating database: %s\n", sqlite3_errmsg(library->db));
         return OPERATION_FAIL;
     }
+    isbnSetFree(library->isbnIndex);
+    free(library);
     return OPERATION_SUCCESS;
-}
\ No newline at end of file
+}
+
+int makeConnection(void) {
+    ConnectionProfile profile = connectionProfilePreset(PROFILE_DURABLE);
+    return makeConnectionEx(&profile);
+}
+
+int makeConnectionEx(const ConnectionProfile* profile) {
+    if (defaultLibrary != NULL) {
+        // Only need to create connection once
+        return OPERATION_SUCCESS;
+    }
+
+    defaultLibrary = libraryOpenEx(DEFAULT_LIBRARY_PATH, LIBRARY_READWRITE | LIBRARY_ISBN_INDEX, profile);
+    return defaultLibrary != NULL ? OPERATION_SUCCESS : OPERATION_FAIL;
+}
+
+LibraryDb* getDefaultLibrary(void) {
+    return defaultLibrary;
+}
+
+int addBook(BookData data) {
+    return libraryAddBook(defaultLibrary, data);
+}
+
+int addBookWithId(BookData data, int64_t* id) {
+    return libraryAddBookWithId(defaultLibrary, data, id);
+}
+
+long addBooks(const BookData* books, size_t numBooks, InsertStatus* statuses) {
+    return libraryAddBooks(defaultLibrary, books, numBooks, statuses);
+}
+
+int upsertBook(BookData data, UpsertPolicy policy) {
+    return libraryUpsertBook(defaultLibrary, data, policy);
+}
+
+void setBatchCommitSize(size_t rows) {
+    librarySetBatchCommitSize(defaultLibrary, rows);
+}
+
+int deleteBookById(int id) {
+    return libraryDeleteBookById(defaultLibrary, id);
+}
+
+long deleteBooksByIds(const int64_t* ids, size_t count) {
+    return libraryDeleteBooksByIds(defaultLibrary, ids, count);
+}
+
+long deleteBooksWhere(const BookFilter* filter) {
+    return libraryDeleteBooksWhere(defaultLibrary, filter);
+}
+
+int updateBook(int64_t id, const BookData* changes, uint32_t fieldMask) {
+    return libraryUpdateBook(defaultLibrary, id, changes, fieldMask);
+}
+
+int hasIsbn(const char* isbn) {
+    return libraryHasIsbn(defaultLibrary, isbn);
+}
+
+BookArray getBooks(void) {
+    return libraryGetBooks(defaultLibrary);
+}
+
+BookArray getBooksArena(void) {
+    return libraryGetBooksArena(defaultLibrary);
+}
+
+int reloadBooks(BookArray* array, int presize) {
+    return libraryReloadBooks(defaultLibrary, array, presize);
+}
+
+int getBooksPage(int64_t afterId, int limit, BookArray* out) {
+    return libraryGetBooksPage(defaultLibrary, afterId, limit, out);
+}
+
+int getBooksPageBefore(int64_t beforeId, int limit, BookArray* out) {
+    return libraryGetBooksPageBefore(defaultLibrary, beforeId, limit, out);
+}
+
+int getBooksWhere(const BookFilter* filter, BookArray* out) {
+    return libraryGetBooksWhere(defaultLibrary, filter, out);
+}
+
+int getBooksWhereFields(const BookFilter* filter, uint32_t fields, BookArray* out) {
+    return libraryGetBooksWhereFields(defaultLibrary, filter, fields, out);
+}
+
+int forEachBook(BookVisitor fn, void* context, const BookFilter* filter) {
+    return libraryForEachBook(defaultLibrary, fn, context, filter);
+}
+
+int forEachBookFields(BookVisitor fn, void* context, const BookFilter* filter, uint32_t fields) {
+    return libraryForEachBookFields(defaultLibrary, fn, context, filter, fields);
+}
+
+int getBookColumns(const BookFilter* filter, BookColumns* out) {
+    return libraryGetBookColumns(defaultLibrary, filter, out);
+}
+
+int getLibraryStats(LibraryStats* out) {
+    return libraryGetLibraryStats(defaultLibrary, out);
+}
+
+int rebuildStats(void) {
+    return libraryRebuildStats(defaultLibrary);
+}
+
+int countBooksBy(uint32_t field, BookGroupVisitor fn, void* context) {
+    return libraryCountBooksBy(defaultLibrary, field, fn, context);
+}
+
+int renameFieldValue(uint32_t field, const char* from, const char* to) {
+    return libraryRenameFieldValue(defaultLibrary, field, from, to);
+}
+
+int migrateSchema(int batchSize, MigrationReport* report) {
+    return libraryMigrateSchema(defaultLibrary, batchSize, report);
+}
+
+int searchLocalBooks(const char* query, int limit, BookArray* out) {
+    return librarySearchBooks(defaultLibrary, query, limit, out);
+}
+
+BookCursor* openBooks(void) {
+    return libraryOpenBooks(defaultLibrary);
+}
+
+StatementCacheStats getStatementCacheStats(void) {
+    return libraryStatementCacheStats(defaultLibrary);
+}
+
+int closeConnection(void) {
+    if (defaultLibrary == NULL) {
+        return OPERATION_FAIL;
+    }
+
+    int result = libraryClose(defaultLibrary);
+    if (result == OPERATION_SUCCESS) {
+        defaultLibrary = NULL;
+    }
+    return result;
+}
@@ -0,0 +1,180 @@
+/**
+ * File: isbn_set.c
+ *
+ * Project: CLManager
+ *
+ * Author: Issiah J Banda
+ *
+ * Date Of Creation: 2026-10-17 //YYYY-MM-DD
+ *
+ * Description: An in memory hash set of packed ISBNs, used to find duplicate
+ *              books without asking the database.
+ *
+ * Modification History:
+ *      - 2026-10-17: Created the ISBN set.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "isbn_set.h"
+
+/* Number of slots of the smallest table.*/
+#define MIN_SET_CAPACITY 64
+
+/* Slots hold the key plus one, so 0 marks an empty slot even for the ISBN
+    0000000000000.*/
+#define EMPTY_SLOT 0
+
+struct IsbnSet {
+    uint64_t* slots;
+    /* Always a power of two, so a hash is turned into a slot with a mask*/
+    size_t capacity;
+    size_t count;
+};
+
+/**
+ * Finds the slot a key is in, or the empty slot where it would go.
+*/
+static size_t findSlot(const IsbnSet* set, uint64_t stored);
+/**
+ * Gets the slot a key hashes to.
+*/
+static size_t homeSlot(const IsbnSet* set, uint64_t stored);
+/**
+ * Moves every key into a table with the given number of slots.
+ * @returns 1 if operation was successful, else returns 0.
+*/
+static int resizeSet(IsbnSet* set, size_t capacity);
+
+int isbnPack(const char* isbn, uint64_t* key) {
+    if (isbn == NULL) {
+        return 0;
+    }
+
+    uint64_t value = 0;
+    int digits = 0;
+    for (; isbn[digits] != '\0'; digits++) {
+        if (digits == 13 || isbn[digits] < '0' || isbn[digits] > '9') {
+            return 0;
+        }
+        value = value * 10 + (uint64_t) (isbn[digits] - '0');
+    }
+    if (digits != 13) {
+        return 0;
+    }
+    *key = value;
+    return 1;
+}
+
+IsbnSet* isbnSetCreate(size_t expected) {
+    IsbnSet* set = calloc(1, sizeof(IsbnSet));
+    if (set == NULL) {
+        fprintf(stderr, "Error Allocating Memory in isbnSetCreate\n");
+        return NULL;
+    }
+
+    // Keep the table at most half full
+    size_t capacity = MIN_SET_CAPACITY;
+    while (capacity < expected * 2) {
+        capacity *= 2;
+    }
+    if (!resizeSet(set, capacity)) {
+        free(set);
+        return NULL;
+    }
+    return set;
+}
+
+int isbnSetAdd(IsbnSet* set, uint64_t key) {
+    if ((set->count + 1) * 2 > set->capacity && !resizeSet(set, set->capacity * 2)) {
+        return 0;
+    }
+
+    uint64_t stored = key + 1;
+    size_t slot = findSlot(set, stored);
+    if (set->slots[slot] == EMPTY_SLOT) {
+        set->slots[slot] = stored;
+        set->count++;
+    }
+    return 1;
+}
+
+void isbnSetRemove(IsbnSet* set, uint64_t key) {
+    size_t mask = set->capacity - 1;
+    size_t slot = findSlot(set, key + 1);
+    if (set->slots[slot] == EMPTY_SLOT) {
+        return;
+    }
+
+    // Shift later keys of the same run back so no lookup stops early at the
+    // hole, which keeps the table free of tombstones
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; set->slots[next] != EMPTY_SLOT; next = (next + 1) & mask) {
+        size_t home = homeSlot(set, set->slots[next]);
+        // The key can fill the hole only if its home is not between the hole and it
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            set->slots[hole] = set->slots[next];
+            hole = next;
+        }
+    }
+    set->slots[hole] = EMPTY_SLOT;
+    set->count--;
+}
+
+int isbnSetContains(const IsbnSet* set, uint64_t key) {
+    return set->slots[findSlot(set, key + 1)] != EMPTY_SLOT;
+}
+
+void isbnSetClear(IsbnSet* set) {
+    for (size_t i = 0; i < set->capacity; i++) {
+        set->slots[i] = EMPTY_SLOT;
+    }
+    set->count = 0;
+}
+
+size_t isbnSetCount(const IsbnSet* set) {
+    return set->count;
+}
+
+void isbnSetFree(IsbnSet* set) {
+    if (set == NULL) {
+        return;
+    }
+    free(set->slots);
+    free(set);
+}
+
+static size_t findSlot(const IsbnSet* set, uint64_t stored) {
+    size_t mask = set->capacity - 1;
+    size_t slot = homeSlot(set, stored);
+    while (set->slots[slot] != EMPTY_SLOT && set->slots[slot] != stored) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static size_t homeSlot(const IsbnSet* set, uint64_t stored) {
+    // Fibonacci hashing spreads the mostly sequential ISBNs over the table
+    return (size_t) ((stored * 0x9E3779B97F4A7C15ull) >> 32) & (set->capacity - 1);
+}
+
+static int resizeSet(IsbnSet* set, size_t capacity) {
+    uint64_t* slots = calloc(capacity, sizeof(uint64_t));
+    if (slots == NULL) {
+        fprintf(stderr, "Error Allocating Memory in isbnSetAdd\n");
+        return 0;
+    }
+
+    uint64_t* old = set->slots;
+    size_t oldCapacity = set->capacity;
+    set->slots = slots;
+    set->capacity = capacity;
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (old[i] != EMPTY_SLOT) {
+            set->slots[findSlot(set, old[i])] = old[i];
+        }
+    }
+    free(old);
+    return 1;
+}
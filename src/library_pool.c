@@ -0,0 +1,138 @@
+/**
+ * File: library_pool.c
+ * 
+ * Project: CLManager
+ * 
+ * Author: Issiah J Banda
+ * 
+ * Date Of Creation: 2026-10-17 //YYYY-MM-DD
+ * 
+ * Description: A pool of library connections for running queries from several
+ *              threads at once. Readers check out one of a fixed set of read only
+ *              connections while a single writer connection takes the writes.
+ * 
+ * Modification History:
+ *      - 2026-10-17: Created the read connection pool and the writer connection.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "library_pool.h"
+
+struct LibraryPool {
+    pthread_mutex_t lock;
+    /* Signalled when a reader is checked in*/
+    pthread_cond_t readerFree;
+    /* Held by the thread that has the writer checked out*/
+    pthread_mutex_t writerLock;
+    LibraryDb* writer;
+    /* Every reader connection, closed in libraryPoolClose*/
+    LibraryDb** readers;
+    int readerCount;
+    /* Stack of the readers that are not checked out*/
+    LibraryDb** freeReaders;
+    int freeCount;
+};
+
+LibraryPool* libraryPoolOpen(const char* path, int readers, const ConnectionProfile* profile) {
+    if (path == NULL || readers < 1) {
+        return NULL;
+    }
+
+    LibraryPool* pool = calloc(1, sizeof(LibraryPool));
+    if (pool == NULL) {
+        fprintf(stderr, "Error Allocating Memory in libraryPoolOpen\n");
+        return NULL;
+    }
+    pool->readers = calloc(readers, sizeof(LibraryDb*));
+    pool->freeReaders = calloc(readers, sizeof(LibraryDb*));
+    if (pool->readers == NULL || pool->freeReaders == NULL) {
+        fprintf(stderr, "Error Allocating Memory in libraryPoolOpen\n");
+        libraryPoolClose(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->readerFree, NULL);
+    pthread_mutex_init(&pool->writerLock, NULL);
+
+    // Readers only run alongside the writer in WAL mode
+    ConnectionProfile tuning = profile != NULL ? *profile : connectionProfilePreset(PROFILE_BALANCED);
+    tuning.journalMode = "WAL";
+
+    // The writer is opened first so the tables exist before the readers open
+    pool->writer = libraryOpenEx(path, LIBRARY_READWRITE, &tuning);
+    if (pool->writer == NULL) {
+        libraryPoolClose(pool);
+        return NULL;
+    }
+
+    for (int i = 0; i < readers; i++) {
+        pool->readers[i] = libraryOpenEx(path, LIBRARY_READONLY, &tuning);
+        if (pool->readers[i] == NULL) {
+            libraryPoolClose(pool);
+            return NULL;
+        }
+        pool->readerCount++;
+        pool->freeReaders[pool->freeCount++] = pool->readers[i];
+    }
+    return pool;
+}
+
+LibraryDb* libraryPoolCheckout(LibraryPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->freeCount == 0) {
+        pthread_cond_wait(&pool->readerFree, &pool->lock);
+    }
+    LibraryDb* reader = pool->freeReaders[--pool->freeCount];
+    pthread_mutex_unlock(&pool->lock);
+    return reader;
+}
+
+void libraryPoolCheckin(LibraryPool* pool, LibraryDb* reader) {
+    if (reader == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->freeReaders[pool->freeCount++] = reader;
+    pthread_cond_signal(&pool->readerFree);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+LibraryDb* libraryPoolCheckoutWriter(LibraryPool* pool) {
+    pthread_mutex_lock(&pool->writerLock);
+    return pool->writer;
+}
+
+void libraryPoolCheckinWriter(LibraryPool* pool) {
+    pthread_mutex_unlock(&pool->writerLock);
+}
+
+int libraryPoolClose(LibraryPool* pool) {
+    if (pool == NULL) {
+        return OPERATION_FAIL;
+    }
+
+    int result = OPERATION_SUCCESS;
+    for (int i = 0; i < pool->readerCount; i++) {
+        if (libraryClose(pool->readers[i]) != OPERATION_SUCCESS) {
+            result = OPERATION_FAIL;
+        }
+    }
+    // The writer closes last so the WAL is checkpointed once the readers are gone
+    if (pool->writer != NULL && libraryClose(pool->writer) != OPERATION_SUCCESS) {
+        result = OPERATION_FAIL;
+    }
+
+    if (pool->readers != NULL && pool->freeReaders != NULL) {
+        pthread_mutex_destroy(&pool->lock);
+        pthread_cond_destroy(&pool->readerFree);
+        pthread_mutex_destroy(&pool->writerLock);
+    }
+    free(pool->readers);
+    free(pool->freeReaders);
+    free(pool);
+    return result;
+}
@@ -13,17 +13,70 @@
  * Modification History:
  *      - 2023-10-05: Testing out database operations in the main function
  *      - 2023-10-16: Testing curl and it's functionallity
+ *      - 2026-10-17: Added the command loop and the view command, which streams
+ *                      books from a BookCursor instead of loading them all.
+ *      - 2026-10-17: Added the import subcommand, CLManager import <file>, which
+ *                      bulk loads a CSV or JSONL file and reports its throughput.
+ *      - 2026-10-17: Added the export subcommand, CLManager export <file>.
+ *      - 2026-10-17: The view command visits books with forEachBook, reading
+ *                      only the title, author and ISBN.
+ *      - 2026-10-17: Added the summary command, which shows the library totals
+ *                      and its top genres.
+ *      - 2026-10-17: Added the rebuild-stats subcommand.
+ *      - 2026-10-17: Added the migrate subcommand.
+ *      - 2026-10-17: The export subcommand opens the library read only.
  * 
 */
 
 #include <stdio.h>
+#include <string.h>
 #include <curl/curl.h>
 
 #include "dbmanager.h"
+#include "book_import.h"
+#include "book_export.h"
 
 void printCommands(void);
+void viewBooks(void);
+int printBook(void* context, const BookView* book);
+void showSummary(void);
+int printGenre(void* context, const char* genre, long books, long long pages);
+int importFile(const char* path);
+int exportFile(const char* path);
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        if (strcmp(argv[1], "import") == 0 && argc == 3) {
+            return importFile(argv[2]) == OPERATION_SUCCESS ? 0 : 1;
+        }
+        if (strcmp(argv[1], "export") == 0 && argc == 3) {
+            return exportFile(argv[2]) == OPERATION_SUCCESS ? 0 : 1;
+        }
+        if (strcmp(argv[1], "rebuild-stats") == 0 && argc == 2) {
+            int oper = makeConnection();
+            if (oper == OPERATION_SUCCESS) {
+                oper = rebuildStats();
+                closeConnection();
+            }
+            return oper == OPERATION_SUCCESS ? 0 : 1;
+        }
+        if (strcmp(argv[1], "migrate") == 0 && argc == 2) {
+            int oper = makeConnection();
+            if (oper == OPERATION_SUCCESS) {
+                MigrationReport report;
+                oper = migrateSchema(0, &report);
+                if (oper == OPERATION_SUCCESS) {
+                    printf("Migrated %ld books in %ld batches (%.2f s)\n", report.books, report.batches, report.seconds);
+                }
+                closeConnection();
+            }
+            return oper == OPERATION_SUCCESS ? 0 : 1;
+        }
+        fprintf(stderr, "Usage: %s [import <file.csv|file.jsonl|file.clmb>] [export <file.csv|file.jsonl|file.clmb|->] "
+                "[rebuild-stats] [migrate]\n", argv[0]);
+        return 1;
+    }
 
-int main(void) {
     int oper = makeConnection();
     if (oper == OPERATION_FAIL) {
         return 1;
@@ -43,7 +96,34 @@ int main(void) {
         curl_easy_cleanup(curl);
     }
 
-    printCommands();
+    char line[64];
+    int running = 1;
+    while (running) {
+        printCommands();
+        printf("> ");
+        if (fgets(line, sizeof(line), stdin) == NULL) {
+            break;
+        }
+
+        switch (line[0]) {
+            case 's':
+                printf("Search is not available yet\n");
+                break;
+            case 'v':
+                viewBooks();
+                break;
+            case 'i':
+                showSummary();
+                break;
+            case 'x':
+                running = 0;
+                break;
+            default:
+                printf("Unknown command\n");
+                break;
+        }
+    }
+
     closeConnection();
 
     return 0;
@@ -53,5 +133,93 @@ void printCommands(void) {
     printf("Commands:\n");
     printf(" s - Search for new books to add to collection\n");
     printf(" v - View books currently available in collection\n");
+    printf(" i - Show a summary of the collection\n");
     printf(" x - Exit the program\n");
-}
\ No newline at end of file
+}
+
+void viewBooks(void) {
+    // Print each book straight from the database row, reading only the
+    // columns that are printed
+    int count = 0;
+    if (forEachBookFields(printBook, &count, NULL, BOOK_FIELD_TITLE | BOOK_FIELD_AUTHOR | BOOK_FIELD_ISBN) == OPERATION_SUCCESS && count == 0) {
+        printf("No books in collection\n");
+    }
+}
+
+int printBook(void* context, const BookView* book) {
+    int* count = context;
+    (*count)++;
+    printf("%d. %s by %s", *count, book->title, book->author);
+    if (book->ISBN != NULL) {
+        printf(" (ISBN %s)", book->ISBN);
+    }
+    printf("\n");
+    return 1;
+}
+
+void showSummary(void) {
+    LibraryStats stats;
+    if (getLibraryStats(&stats) == OPERATION_FAIL) {
+        return;
+    }
+
+    printf("%ld books, %lld pages\n", stats.books, stats.totalPages);
+    printf("%ld authors, %ld genres, %ld languages\n", stats.authors, stats.genres, stats.languages);
+    if (stats.genres > 0) {
+        int shown = 0;
+        printf("Top genres:\n");
+        countBooksBy(BOOK_FIELD_GENRE, printGenre, &shown);
+    }
+}
+
+int printGenre(void* context, const char* genre, long books, long long pages) {
+    int* shown = context;
+    if (genre == NULL) {
+        return 1; // Books without a genre are not a genre
+    }
+    printf(" %s: %ld books, %lld pages\n", genre, books, pages);
+    return ++(*shown) < 5;
+}
+
+int importFile(const char* path) {
+    // Bulk load settings, the import can be run again if it is interrupted
+    ConnectionProfile profile = connectionProfilePreset(PROFILE_BULK_LOAD);
+    if (makeConnectionEx(&profile) == OPERATION_FAIL) {
+        return OPERATION_FAIL;
+    }
+
+    ImportReport report;
+    int oper = importBooks(getDefaultLibrary(), path, importFormatForPath(path), &report);
+    closeConnection();
+
+    printf("Read %ld rows in %.2f seconds", report.rowsRead, report.seconds);
+    if (report.seconds > 0) {
+        printf(" (%.0f rows/sec)", report.rowsRead / report.seconds);
+    }
+    printf("\n");
+    printf(" Inserted:   %ld\n", report.inserted);
+    printf(" Duplicates: %ld\n", report.duplicates);
+    printf(" Invalid:    %ld\n", report.invalid);
+    printf(" Malformed:  %ld\n", report.malformed);
+    if (report.peakMemoryKb >= 0) {
+        printf(" Peak memory: %ld KiB\n", report.peakMemoryKb);
+    }
+    return oper;
+}
+
+int exportFile(const char* path) {
+    // Only reads, so it needs neither the write lock nor the ISBN index
+    LibraryDb* library = libraryOpen(DEFAULT_LIBRARY_PATH, LIBRARY_READONLY);
+    if (library == NULL) {
+        return OPERATION_FAIL;
+    }
+
+    ExportReport report;
+    int oper = exportBooks(library, path, exportFormatForPath(path), &report);
+    libraryClose(library);
+
+    // Keep standard output clean when the books are written to it
+    FILE* out = strcmp(path, "-") == 0 ? stderr : stdout;
+    fprintf(out, "Wrote %ld books (%lld bytes) in %.2f seconds\n", report.books, report.bytes, report.seconds);
+    return oper;
+}
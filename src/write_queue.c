@@ -0,0 +1,457 @@
+/**
+ * File: write_queue.c
+ * 
+ * Project: CLManager
+ * 
+ * Author: Issiah J Banda
+ * 
+ * Date Of Creation: 2026-10-17 //YYYY-MM-DD
+ * 
+ * Description: Moves book writes off the calling thread. Writes are pushed onto a
+ *              lock-free multiple producer, single consumer queue that a writer
+ *              thread drains, committing each batch it drains as one transaction.
+ * 
+ * Modification History:
+ *      - 2026-10-17: Created the write queue, its writer thread and the async
+ *                      versions of addBook and deleteBookById.
+ *      - 2026-10-17: A group transaction that an error rolled back is restarted for the
+ *                      writes after it.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "write_queue.h"
+
+/* The most writes committed inside one transaction.*/
+#define MAX_GROUP_SIZE 1024
+
+/* What a queued write does.*/
+typedef enum {
+    WRITE_ADD,
+    WRITE_DELETE,
+    /* Does nothing, its callback tells writeQueueFlush it was reached*/
+    WRITE_FLUSH
+} WriteKind;
+
+/* A queued write. An add owns copies of the book's strings, which are
+    allocated in the same block right after the struct.*/
+typedef struct WriteOp {
+    _Atomic(struct WriteOp*) next;
+    WriteKind kind;
+    BookData data;
+    int id;
+    WriteCallback callback;
+    void* context;
+    int result;
+    int64_t resultId;
+} WriteOp;
+
+struct WriteQueue {
+    /* Producers push at the head, the writer thread pops at the tail*/
+    _Atomic(WriteOp*) head;
+    WriteOp* tail;
+    /* Always in the queue so it is never empty, see popOp*/
+    WriteOp stub;
+
+    LibraryDb* library;
+    pthread_t thread;
+    atomic_int stopping;
+    /* Set while the writer thread waits for work, so producers know to wake it*/
+    atomic_int sleeping;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+};
+
+/* Lets writeQueueFlush wait for its flush op.*/
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    int reached;
+} FlushWaiter;
+
+/* The queue used by the async functions that do not take a WriteQueue.*/
+static WriteQueue* defaultQueue;
+
+/**
+ * Pushes an op onto the queue and wakes the writer thread if it is waiting.
+ * Safe to call from any number of threads.
+*/
+static void pushOp(WriteQueue* queue, WriteOp* op);
+/**
+ * Pops the oldest op from the queue. Only called by the writer thread.
+ * @returns The op, or NULL if the queue is empty or a producer is half way
+ *          through pushing.
+*/
+static WriteOp* popOp(WriteQueue* queue);
+/**
+ * Checks whether every pushed op has been popped.
+*/
+static int queueEmpty(WriteQueue* queue);
+/**
+ * The writer thread. Drains the queue in groups until the queue is stopped.
+*/
+static void* writerMain(void* arg);
+/**
+ * Pops up to MAX_GROUP_SIZE ops, runs them inside one transaction and calls
+ * their callbacks once the transaction is over.
+ * @returns The number of ops handled.
+*/
+static int commitGroup(WriteQueue* queue);
+/**
+ * Copies a string into the block of an op.
+ * @returns The copy, or NULL if src is NULL.
+*/
+static char* copyInto(char** cursor, const char* src);
+/**
+ * The callback of a flush op, wakes the thread waiting in writeQueueFlush.
+*/
+static void flushReached(void* context, int result, int64_t id);
+
+WriteQueue* writeQueueStart(const char* path, const ConnectionProfile* profile) {
+    WriteQueue* queue = calloc(1, sizeof(WriteQueue));
+    if (queue == NULL) {
+        fprintf(stderr, "Error Allocating Memory in writeQueueStart\n");
+        return NULL;
+    }
+
+    queue->library = profile != NULL ? libraryOpenEx(path, LIBRARY_READWRITE, profile)
+                                     : libraryOpen(path, LIBRARY_READWRITE);
+    if (queue->library == NULL) {
+        free(queue);
+        return NULL;
+    }
+
+    atomic_init(&queue->stub.next, NULL);
+    atomic_init(&queue->head, &queue->stub);
+    queue->tail = &queue->stub;
+    atomic_init(&queue->stopping, 0);
+    atomic_init(&queue->sleeping, 0);
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->wake, NULL);
+
+    if (pthread_create(&queue->thread, NULL, writerMain, queue) != 0) {
+        fprintf(stderr, "Cannot start writer thread\n");
+        pthread_mutex_destroy(&queue->lock);
+        pthread_cond_destroy(&queue->wake);
+        libraryClose(queue->library);
+        free(queue);
+        return NULL;
+    }
+    return queue;
+}
+
+int writeQueueAddBook(WriteQueue* queue, const BookData* data, WriteCallback callback, void* context) {
+    if (queue == NULL || data == NULL) {
+        return OPERATION_FAIL;
+    }
+
+    // One block for the op and its strings, so the writer frees it with one call
+    const char* fields[] = {data->title, data->author, data->publisher, data->publicationDate,
+                            data->ISBN, data->genre, data->lang};
+    size_t size = sizeof(WriteOp);
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        if (fields[i] != NULL) {
+            size += strlen(fields[i]) + 1;
+        }
+    }
+
+    WriteOp* op = malloc(size);
+    if (op == NULL) {
+        fprintf(stderr, "Error Allocating Memory in writeQueueAddBook\n");
+        return OPERATION_FAIL;
+    }
+
+    char* cursor = (char*) (op + 1);
+    op->kind = WRITE_ADD;
+    op->data.title = copyInto(&cursor, data->title);
+    op->data.author = copyInto(&cursor, data->author);
+    op->data.publisher = copyInto(&cursor, data->publisher);
+    op->data.publicationDate = copyInto(&cursor, data->publicationDate);
+    op->data.ISBN = copyInto(&cursor, data->ISBN);
+    op->data.genre = copyInto(&cursor, data->genre);
+    op->data.lang = copyInto(&cursor, data->lang);
+    op->data.numPages = data->numPages;
+    op->data.id = 0;
+    op->id = 0;
+    op->callback = callback;
+    op->context = context;
+    pushOp(queue, op);
+    return OPERATION_SUCCESS;
+}
+
+int writeQueueDeleteBook(WriteQueue* queue, int id, WriteCallback callback, void* context) {
+    if (queue == NULL || id < 1) {
+        return OPERATION_FAIL;
+    }
+
+    WriteOp* op = calloc(1, sizeof(WriteOp));
+    if (op == NULL) {
+        fprintf(stderr, "Error Allocating Memory in writeQueueDeleteBook\n");
+        return OPERATION_FAIL;
+    }
+
+    op->kind = WRITE_DELETE;
+    op->id = id;
+    op->callback = callback;
+    op->context = context;
+    pushOp(queue, op);
+    return OPERATION_SUCCESS;
+}
+
+void writeQueueFlush(WriteQueue* queue) {
+    if (queue == NULL) {
+        return;
+    }
+
+    WriteOp* op = calloc(1, sizeof(WriteOp));
+    if (op == NULL) {
+        fprintf(stderr, "Error Allocating Memory in writeQueueFlush\n");
+        return;
+    }
+
+    FlushWaiter waiter;
+    pthread_mutex_init(&waiter.lock, NULL);
+    pthread_cond_init(&waiter.done, NULL);
+    waiter.reached = 0;
+
+    op->kind = WRITE_FLUSH;
+    op->callback = flushReached;
+    op->context = &waiter;
+    pushOp(queue, op);
+
+    // Ops are handled in order, so every earlier op is done once this one is
+    pthread_mutex_lock(&waiter.lock);
+    while (!waiter.reached) {
+        pthread_cond_wait(&waiter.done, &waiter.lock);
+    }
+    pthread_mutex_unlock(&waiter.lock);
+
+    pthread_mutex_destroy(&waiter.lock);
+    pthread_cond_destroy(&waiter.done);
+}
+
+int writeQueueStop(WriteQueue* queue) {
+    if (queue == NULL) {
+        return OPERATION_FAIL;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    atomic_store(&queue->stopping, 1);
+    pthread_cond_signal(&queue->wake);
+    pthread_mutex_unlock(&queue->lock);
+    pthread_join(queue->thread, NULL);
+
+    int result = libraryClose(queue->library);
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->wake);
+    free(queue);
+    return result;
+}
+
+static void pushOp(WriteQueue* queue, WriteOp* op) {
+    atomic_store(&op->next, NULL);
+    WriteOp* prev = atomic_exchange(&queue->head, op);
+    // Between the exchange and this store the op is pushed but not yet reachable
+    atomic_store(&prev->next, op);
+
+    if (atomic_load(&queue->sleeping)) {
+        pthread_mutex_lock(&queue->lock);
+        pthread_cond_signal(&queue->wake);
+        pthread_mutex_unlock(&queue->lock);
+    }
+}
+
+static WriteOp* popOp(WriteQueue* queue) {
+    WriteOp* tail = queue->tail;
+    WriteOp* next = atomic_load(&tail->next);
+
+    // Skip over the stub
+    if (tail == &queue->stub) {
+        if (next == NULL) {
+            return NULL;
+        }
+        queue->tail = next;
+        tail = next;
+        next = atomic_load(&tail->next);
+    }
+
+    if (next != NULL) {
+        queue->tail = next;
+        return tail;
+    }
+
+    // tail is the last op linked in. Unless a push is half way done, put the
+    // stub back behind it so tail can be taken without emptying the queue
+    if (tail != atomic_load(&queue->head)) {
+        return NULL;
+    }
+    pushOp(queue, &queue->stub);
+
+    next = atomic_load(&tail->next);
+    if (next != NULL) {
+        queue->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+static int queueEmpty(WriteQueue* queue) {
+    WriteOp* tail = queue->tail;
+    return tail == atomic_load(&queue->head) && tail == &queue->stub;
+}
+
+static void* writerMain(void* arg) {
+    WriteQueue* queue = arg;
+
+    while (1) {
+        if (commitGroup(queue) > 0) {
+            continue;
+        }
+
+        if (!queueEmpty(queue)) {
+            // A producer is between its two steps of pushOp, give it a moment
+            sched_yield();
+            continue;
+        }
+        if (atomic_load(&queue->stopping)) {
+            break;
+        }
+
+        // Announce the wait before checking the queue again, so a producer
+        // either sees the flag or its op is seen here
+        pthread_mutex_lock(&queue->lock);
+        atomic_store(&queue->sleeping, 1);
+        if (queueEmpty(queue) && !atomic_load(&queue->stopping)) {
+            pthread_cond_wait(&queue->wake, &queue->lock);
+        }
+        atomic_store(&queue->sleeping, 0);
+        pthread_mutex_unlock(&queue->lock);
+    }
+    return NULL;
+}
+
+static int commitGroup(WriteQueue* queue) {
+    WriteOp* group[MAX_GROUP_SIZE];
+    int count = 0;
+    WriteOp* op;
+
+    while (count < MAX_GROUP_SIZE && (op = popOp(queue)) != NULL) {
+        group[count++] = op;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    int inTransaction = libraryBeginWrite(queue->library);
+    int transactionStart = 0;
+    for (int i = 0; i < count; i++) {
+        op = group[i];
+        op->result = OPERATION_FAIL;
+        op->resultId = op->id;
+        if (!inTransaction) {
+            continue;
+        }
+
+        // A failed add or delete only undoes itself, the rest of the group still commits
+        if (op->kind == WRITE_ADD) {
+            op->result = libraryAddBookWithId(queue->library, op->data, &op->resultId);
+        } else if (op->kind == WRITE_DELETE) {
+            op->result = libraryDeleteBookById(queue->library, op->id);
+        } else {
+            op->result = OPERATION_SUCCESS;
+        }
+
+        if (!libraryInTransaction(queue->library)) {
+            // The error rolled back the whole transaction, taking the ops run in
+            // it so far along, so the rest of the group starts a new one
+            for (int j = transactionStart; j <= i; j++) {
+                if (group[j]->kind != WRITE_FLUSH) {
+                    group[j]->result = OPERATION_FAIL;
+                }
+            }
+            inTransaction = libraryBeginWrite(queue->library);
+            transactionStart = i + 1;
+        }
+    }
+
+    if (inTransaction && !libraryCommit(queue->library)) {
+        // Nothing since the transaction started was stored
+        libraryRollback(queue->library);
+        for (int i = transactionStart; i < count; i++) {
+            if (group[i]->kind != WRITE_FLUSH) {
+                group[i]->result = OPERATION_FAIL;
+            }
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        op = group[i];
+        if (op->kind == WRITE_FLUSH) {
+            // The flush op lives until its waiter wakes, free it first
+            WriteCallback callback = op->callback;
+            void* context = op->context;
+            free(op);
+            callback(context, OPERATION_SUCCESS, 0);
+            continue;
+        }
+        if (op->callback != NULL) {
+            op->callback(op->context, op->result, op->resultId);
+        }
+        free(op);
+    }
+    return count;
+}
+
+static char* copyInto(char** cursor, const char* src) {
+    if (src == NULL) {
+        return NULL;
+    }
+
+    size_t size = strlen(src) + 1;
+    char* dest = *cursor;
+    memcpy(dest, src, size);
+    *cursor += size;
+    return dest;
+}
+
+static void flushReached(void* context, int result, int64_t id) {
+    (void) result;
+    (void) id;
+    FlushWaiter* waiter = context;
+    pthread_mutex_lock(&waiter->lock);
+    waiter->reached = 1;
+    pthread_cond_signal(&waiter->done);
+    pthread_mutex_unlock(&waiter->lock);
+}
+
+int startAsyncWrites(void) {
+    if (defaultQueue != NULL) {
+        return OPERATION_SUCCESS;
+    }
+
+    defaultQueue = writeQueueStart(DEFAULT_LIBRARY_PATH, NULL);
+    return defaultQueue != NULL ? OPERATION_SUCCESS : OPERATION_FAIL;
+}
+
+int addBookAsync(BookData data, WriteCallback callback, void* context) {
+    return writeQueueAddBook(defaultQueue, &data, callback, context);
+}
+
+int deleteBookByIdAsync(int id, WriteCallback callback, void* context) {
+    return writeQueueDeleteBook(defaultQueue, id, callback, context);
+}
+
+int stopAsyncWrites(void) {
+    if (defaultQueue == NULL) {
+        return OPERATION_FAIL;
+    }
+
+    int result = writeQueueStop(defaultQueue);
+    defaultQueue = NULL;
+    return result;
+}